@@ -0,0 +1,384 @@
+#include "../private/postcard_detail.hxx"
+#include <ice/postcard.hxx>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Every allocation in the process is counted, including the ones done by the default postcard allocator.
+static std::atomic<ice::postcard::u64> global_allocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    global_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* const result = std::malloc(size == 0 ? 1 : size))
+    {
+        return result;
+    }
+    throw std::bad_alloc{ };
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    global_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* location) noexcept
+{
+    std::free(location);
+}
+
+void operator delete(void* location, std::size_t) noexcept
+{
+    std::free(location);
+}
+
+namespace ice::postcard::bench
+{
+
+    using ice::postcard::detail::simd::Isa;
+
+    enum class Operation : ice::postcard::u8
+    {
+        Write,
+        Read,
+        ReadInto,
+        ReadInfo,
+        Capacity,
+    };
+
+    struct Config
+    {
+        ice::postcard::u32 size;
+        ice::postcard::u8 channels;
+        ice::postcard::ChannelDepth depth;
+        ice::postcard::usize attachment_size;
+        ice::postcard::Density density;
+        ice::postcard::Compression compression;
+        ice::postcard::detail::simd::Isa isa;
+        bool striped;
+        bool checksum;
+    };
+
+    struct Options
+    {
+        double min_seconds = 0.1;
+        bool quick = false;
+        std::string_view filter;
+    };
+
+    static constexpr char const* Constant_OperationNames[]{ "write", "read", "read_into", "read_info", "capacity" };
+    static constexpr char const* Constant_IsaNames[]{ "scalar", "sse41", "avx2", "avx512" };
+
+    //! \brief Number of image bytes a call has to process, used to report the throughput.
+    static auto image_bytes_processed(
+        ice::postcard::Image const& image,
+        Operation operation
+    ) noexcept -> ice::postcard::usize
+    {
+        ice::postcard::PostcardInfo info{ };
+        if (operation == Operation::Capacity || ice::postcard::read_info(image, info) != ice::postcard::Result::Success)
+        {
+            return 0;
+        }
+
+        // Header and trailer are counted as well, they are decoded the same way as the attachment.
+        ice::postcard::usize const header_channels = 12 * 8;
+        ice::postcard::usize const channel_size = ice::postcard::usize(image.depth);
+        if (operation == Operation::ReadInfo)
+        {
+            return (image.channels == 4 ? header_channels / 3 * 4 : header_channels) * channel_size;
+        }
+
+        ice::postcard::usize const stored = info.compression == Compression::LZ ? info.compressed_size + 4 : info.attachment_size;
+        ice::postcard::usize const trailer = info.has_checksum ? 4 : 0;
+        ice::postcard::usize const channels = header_channels + ((stored + trailer) * 8) / ice::postcard::usize(info.density);
+        return (image.channels == 4 ? (channels + 2) / 3 * 4 : channels) * channel_size;
+    }
+
+    static auto run_operation(
+        Operation operation,
+        Config const& config,
+        ice::postcard::Image& image,
+        ice::postcard::Data attachment,
+        ice::postcard::Memory read_buffer
+    ) noexcept -> ice::postcard::Result
+    {
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default();
+        ice::postcard::Executor& executor = ice::postcard::Executor::get_default();
+        ice::postcard::PostcardInfo info{
+            .attachment_size = attachment.size,
+            .compression = config.compression,
+            .density = config.density,
+            .has_checksum = config.checksum,
+        };
+
+        switch (operation)
+        {
+        case Operation::Write:
+            return config.striped
+                ? ice::postcard::write(image, info, attachment, executor)
+                : ice::postcard::write(image, info, attachment);
+        case Operation::Read:
+        {
+            ice::postcard::Memory result{ };
+            ice::postcard::Result const read_result = config.striped
+                ? ice::postcard::read(image, info, result, allocator, executor)
+                : ice::postcard::read(image, info, result, allocator);
+            allocator.deallocate(result);
+            return read_result;
+        }
+        case Operation::ReadInto:
+            return ice::postcard::read_into(image, info, read_buffer);
+        case Operation::ReadInfo:
+            return ice::postcard::read_info(image, info);
+        case Operation::Capacity:
+        {
+            // Keep the result alive, so the call is not removed.
+            static std::atomic<ice::postcard::usize> sink;
+            sink.store(ice::postcard::capacity(image, config.density), std::memory_order_relaxed);
+            return ice::postcard::Result::Success;
+        }
+        }
+        return ice::postcard::Result::Success;
+    }
+
+    static void print_row(
+        Config const& config,
+        Operation operation,
+        char const* status,
+        ice::postcard::u64 iterations,
+        double ns_per_call,
+        double image_gbps,
+        double allocations_per_call
+    ) noexcept
+    {
+        std::printf(
+            "%s,%s,%s,%s,%s,%u,%u,%u,%zu,%u,%s,%llu,%.1f,%.3f,%.2f\n",
+            Constant_OperationNames[ice::postcard::u32(operation)],
+            config.striped ? "striped" : "single",
+            Constant_IsaNames[ice::postcard::u32(config.isa)],
+            config.checksum ? "crc32c" : "none",
+            status,
+            config.channels,
+            ice::postcard::u32(config.depth) * 8,
+            config.size,
+            config.attachment_size,
+            ice::postcard::u32(config.density),
+            config.compression == Compression::LZ ? "lz" : "none",
+            static_cast<unsigned long long>(iterations),
+            ns_per_call,
+            image_gbps,
+            allocations_per_call
+        );
+    }
+
+    static void run_config(
+        Options const& options,
+        Config const& config,
+        ice::postcard::Image& image,
+        std::vector<ice::postcard::u8> const& attachment_source
+    ) noexcept
+    {
+        ice::postcard::Data const attachment{ attachment_source.data(), config.attachment_size };
+        if (config.attachment_size > ice::postcard::capacity(image, config.density))
+        {
+            return;
+        }
+
+        // Large enough for the attachment and its compressed form, which 'read_into' extracts behind it.
+        std::vector<ice::postcard::u8> read_buffer_storage(config.attachment_size * 2);
+        ice::postcard::Memory const read_buffer{ read_buffer_storage.data(), read_buffer_storage.size() };
+
+        ice::postcard::detail::simd::limit_isa(config.isa);
+        for (Operation operation : { Operation::Write, Operation::Read, Operation::ReadInto, Operation::ReadInfo, Operation::Capacity })
+        {
+            // There is no parallel version of 'read_into'.
+            if (operation == Operation::ReadInto && config.striped)
+            {
+                continue;
+            }
+
+            char name[128];
+            std::snprintf(
+                name, sizeof(name), "%s/%s/%s/%s/%u/%ubit/%ux%u/%zu/%u/%s",
+                Constant_OperationNames[ice::postcard::u32(operation)],
+                config.striped ? "striped" : "single",
+                Constant_IsaNames[ice::postcard::u32(config.isa)],
+                config.checksum ? "crc32c" : "none",
+                config.channels,
+                ice::postcard::u32(config.depth) * 8,
+                config.size, config.size,
+                config.attachment_size,
+                ice::postcard::u32(config.density),
+                config.compression == Compression::LZ ? "lz" : "none"
+            );
+            if (options.filter.empty() == false && std::string_view{ name }.find(options.filter) == std::string_view::npos)
+            {
+                continue;
+            }
+
+            // Every operation apart from 'write' needs a postcard to work on, this also warms up caches and threads.
+            ice::postcard::Result result = run_operation(Operation::Write, config, image, attachment, read_buffer);
+            if (result == ice::postcard::Result::Success)
+            {
+                result = run_operation(operation, config, image, attachment, read_buffer);
+            }
+            if (result != ice::postcard::Result::Success)
+            {
+                print_row(config, operation, "error", 0, 0.0, 0.0, 0.0);
+                continue;
+            }
+
+            using Clock = std::chrono::steady_clock;
+            ice::postcard::u64 iterations = 0;
+            ice::postcard::u64 const allocations_start = global_allocations.load(std::memory_order_relaxed);
+            Clock::time_point const start = Clock::now();
+            Clock::duration elapsed{ };
+            do
+            {
+                // Check the clock in batches, so fast calls like 'capacity' are not dominated by it.
+                for (ice::postcard::u32 idx = 0; idx < 16; idx += 1)
+                {
+                    run_operation(operation, config, image, attachment, read_buffer);
+                }
+                iterations += 16;
+                elapsed = Clock::now() - start;
+            } while (std::chrono::duration<double>(elapsed).count() < options.min_seconds);
+
+            double const seconds = std::chrono::duration<double>(elapsed).count();
+            double const allocations = double(global_allocations.load(std::memory_order_relaxed) - allocations_start) / double(iterations);
+            double const bytes = double(image_bytes_processed(image, operation)) * double(iterations);
+
+            print_row(
+                config,
+                operation,
+                "ok",
+                iterations,
+                seconds * 1e9 / double(iterations),
+                bytes / seconds / 1e9,
+                allocations
+            );
+        }
+    }
+
+    static int run(Options const& options) noexcept
+    {
+        std::vector<ice::postcard::u32> const sizes = options.quick
+            ? std::vector<ice::postcard::u32>{ 256, 1024 }
+            : std::vector<ice::postcard::u32>{ 256, 1024, 4096 };
+
+        Isa const widest_isa = ice::postcard::detail::simd::selected_isa();
+        std::mt19937 random{ 0x49'53'50'43 };
+
+        // Random bytes do not compress, so the compressed runs use a repeating text instead.
+        std::vector<ice::postcard::u8> random_attachment(4096 * 4096 * 4 / 2);
+        std::vector<ice::postcard::u8> text_attachment(random_attachment.size());
+        std::generate(random_attachment.begin(), random_attachment.end(), [&]() noexcept { return ice::postcard::u8(random()); });
+        for (ice::postcard::usize idx = 0; idx < text_attachment.size(); idx += 1)
+        {
+            static constexpr char Constant_Text[] = "The quick brown fox jumps over the lazy dog. ";
+            text_attachment[idx] = ice::postcard::u8(Constant_Text[(idx + idx / 997) % (sizeof(Constant_Text) - 1)]);
+        }
+
+        std::printf("operation,path,isa,checksum,status,channels,depth,size,attachment_size,density,compression,iterations,ns_per_call,image_gbps,allocations_per_call\n");
+        for (ice::postcard::u32 size : sizes)
+        {
+            for (auto [channels, depth] : {
+                std::pair{ ice::postcard::u8(3), ChannelDepth::Bits8 },
+                std::pair{ ice::postcard::u8(4), ChannelDepth::Bits8 },
+                std::pair{ ice::postcard::u8(3), ChannelDepth::Bits16 },
+                std::pair{ ice::postcard::u8(4), ChannelDepth::Bits16 },
+            })
+            {
+                std::vector<ice::postcard::u8> pixels(ice::postcard::usize(size) * size * channels * ice::postcard::usize(depth));
+                std::generate(pixels.begin(), pixels.end(), [&]() noexcept { return ice::postcard::u8(random()); });
+                ice::postcard::Image image{ size, size, channels, { pixels.data(), pixels.size() }, 0, depth };
+
+                for (ice::postcard::Density density : { Density::Bits1, Density::Bits2, Density::Bits4 })
+                {
+                    ice::postcard::usize const full = ice::postcard::capacity(image, density);
+                    for (ice::postcard::usize attachment_size : { ice::postcard::usize(64), ice::postcard::usize(4096), ice::postcard::usize(256 * 1024), full })
+                    {
+                        Config config{
+                            .size = size,
+                            .channels = channels,
+                            .depth = depth,
+                            .attachment_size = attachment_size,
+                            .density = density,
+                            .compression = Compression::None,
+                            .isa = widest_isa,
+                            .striped = false,
+                            .checksum = false,
+                        };
+
+                        // Each instruction set is compared on the single threaded path, the others use the widest one.
+                        for (ice::postcard::u8 isa = 0; isa <= ice::postcard::u8(widest_isa); isa += 1)
+                        {
+                            config.isa = Isa(isa);
+                            config.striped = false;
+                            run_config(options, config, image, random_attachment);
+                        }
+
+                        // The remaining paths do not depend on the channel depth.
+                        if (depth != ChannelDepth::Bits8)
+                        {
+                            continue;
+                        }
+
+                        config.isa = widest_isa;
+                        config.striped = true;
+                        run_config(options, config, image, random_attachment);
+
+                        config.striped = false;
+                        config.checksum = true;
+                        run_config(options, config, image, random_attachment);
+
+                        config.checksum = false;
+                        config.compression = Compression::LZ;
+                        run_config(options, config, image, text_attachment);
+                    }
+                }
+            }
+        }
+
+        ice::postcard::detail::simd::limit_isa(Isa::AVX512);
+        return 0;
+    }
+
+} // namespace ice::postcard::bench
+
+int main(int argc, char** argv)
+{
+    ice::postcard::bench::Options options{ };
+    for (int idx = 1; idx < argc; idx += 1)
+    {
+        std::string_view const arg{ argv[idx] };
+        if (arg == "--quick")
+        {
+            options.quick = true;
+            options.min_seconds = 0.01;
+        }
+        else if (arg.starts_with("--min-time="))
+        {
+            options.min_seconds = std::atof(argv[idx] + std::size("--min-time=") - 1);
+        }
+        else if (arg.starts_with("--filter="))
+        {
+            options.filter = arg.substr(std::size("--filter=") - 1);
+        }
+        else
+        {
+            std::fprintf(stderr, "usage: postcard_bench [--quick] [--min-time=<seconds>] [--filter=<substring>]\n");
+            return 1;
+        }
+    }
+    return ice::postcard::bench::run(options);
+}
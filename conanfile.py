@@ -17,8 +17,8 @@ class IceShardPostcardRecipe(ConanFile):
 
     # Binary configuration
     settings = "os", "compiler", "build_type", "arch"
-    options = {"shared": [True,False], "fPIC": [True, False]}
-    default_options = {"shared":False,"fPIC": True}
+    options = {"shared": [True,False], "fPIC": [True, False], "stats": [True, False]}
+    default_options = {"shared":False,"fPIC": True, "stats": False}
 
     # Sources are located in the same place as this recipe, copy them to the recipe
     exports_sources = "CMakeLists.txt", "private/*", "public/*"
@@ -39,6 +39,8 @@ class IceShardPostcardRecipe(ConanFile):
         deps = CMakeDeps(self)
         deps.generate()
         tc = CMakeToolchain(self, "Ninja")
+        tc.variables["POSTCARD_BUILD_BENCHMARK"] = False
+        tc.variables["POSTCARD_STATS"] = bool(self.options.stats)
         tc.generate()
 
     def build(self):
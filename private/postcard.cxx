@@ -1,32 +1,31 @@
-#include <ice/postcard.hxx>
+#include "postcard_detail.hxx"
+#include <ice/postcard_async.hxx>
+#include <algorithm>
+#include <bit>
 #include <memory>
+#include <new>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <numeric>
 #include <span>
+#include <utility>
 
-#if !defined(ICE_POSTCARD_SIMD_ENABLED)
-#define ICE_POSTCARD_SIMD_ENABLED 0
-//#define ICE_POSTCARD_SIMD_AVX_ENABLED 0 TODO: We might want to also make use of avx?
-#else
-#undef ICE_POSTCARD_SIMD_ENABLED
-#define ICE_POSTCARD_SIMD_ENABLED 1
-#endif
-
-#if ICE_POSTCARD_SIMD_ENABLED
-#include <intrin.h>
-#endif
 namespace ice::postcard
 {
 
     class DefaultAllocator : public ice::postcard::Allocator
     {
+        // Goes through the global allocation functions, so applications (and our benchmarks) can replace them.
         auto allocate(ice::postcard::usize size) noexcept -> ice::postcard::Memory
         {
-            return { malloc(size), size };
+            return { ::operator new(size, std::nothrow), size };
         }
 
         void deallocate(ice::postcard::Memory memory) noexcept
         {
-            free(memory.location);
+            ::operator delete(memory.location);
         }
     };
 
@@ -42,7 +41,12 @@ namespace ice::postcard
     }
 
     Attachment::Attachment(ice::postcard::Data data) noexcept
-        : Attachment{ { }, ice::postcard::Allocator::get_default() }
+        : Attachment{ data, ice::postcard::Allocator::get_default() }
+    {
+    }
+
+    Attachment::Attachment(ice::postcard::Data data, ice::postcard::Allocator& alloc) noexcept
+        : Attachment{ ice::postcard::Memory{ }, alloc }
     {
         if (data.size > 0)
         {
@@ -52,531 +56,3206 @@ namespace ice::postcard
     }
 
     Attachment::Attachment(ice::postcard::Memory memory, ice::postcard::Allocator& alloc) noexcept
-        : _data{ memory }
-        , _allocator{ &alloc }
+        : _allocator{ &alloc }
+        , _data{ memory }
     {
     }
 
     Attachment::~Attachment() noexcept
     {
         assert(_allocator != nullptr);
-        _allocator->deallocate(_data);
+        if (_data.location != nullptr)
+        {
+            _allocator->deallocate(_data);
+        }
     }
 
-    namespace detail
+    Attachment::Attachment(Attachment&& other) noexcept
+        : _allocator{ other._allocator }
+        , _data{ std::exchange(other._data, { }) }
     {
+    }
 
-        auto write_postcard_data(
-            ice::postcard::Memory target,
-            ice::postcard::Data source,
-            ice::postcard::u8 channel_count,
-            ice::postcard::u8& out_last_written_channel
-        ) noexcept -> ice::postcard::usize;
-
-        auto read_postcard_data(
-            ice::postcard::Memory target,
-            ice::postcard::Data source,
-            ice::postcard::u8 channel_count,
-            ice::postcard::u8& out_last_read_channel
-        ) noexcept -> ice::postcard::usize;
-
-        namespace simd
-        {
-
-            auto write_postcard_data(
-                ice::postcard::Memory target,
-                ice::postcard::Data source,
-                ice::postcard::u8 channel_count,
-                ice::postcard::u8& out_last_written_channel
-            ) noexcept -> ice::postcard::usize;
-
-            auto read_postcard_data(
-                ice::postcard::Memory& target,
-                ice::postcard::Data source,
-                ice::postcard::u8 channel_count,
-                ice::postcard::u8& out_last_read_channel
-            ) noexcept -> ice::postcard::usize;
-
-            static constexpr bool Constant_EnabledSIMD = ICE_POSTCARD_SIMD_ENABLED == 1;
-
-            // TODO: Might be usefull later
-            //static constexpr bool Constant_EnabledAVX = false;
-            //static constexpr ice::u8 Constant_ComponentCount = Constant_EnabledAVX ? 32 : 16;
-
-            static constexpr ice::postcard::u8 Constant_ComponentCopyMask[32]{
-                0x00, 0x00, 0x00, 0x00,
-                0x00, 0x00, 0x00, 0x00,
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-                0x02, 0x02, 0x02, 0x02,
-                0x02, 0x02, 0x02, 0x02,
-                0x03, 0x03, 0x03, 0x03,
-                0x03, 0x03, 0x03, 0x03,
-            };
-
-            // TODO: Fix issue with reading 4 channel images with data
-            //static constexpr ice::u8 Constant_SSE_ComponentRead4Mask[16]{
-            //    0x00, 0x01, 0x02, 0x04, // 1'st byte
-            //    0x05, 0x06, 0x08, 0x09, // 1/2'st byte
-            //    0x05, 0x06, 0x08, 0x09, // 1/2'st byte
-            //    0x0a, 0x0c, 0x0d, 0x0e, // 2'st byte
-            //    // Represents alpha channels, we don't use
-            //    //0x03, 0x07, 0x0b, 0x0f,
-            //};
-
-            static constexpr ice::postcard::u8 Constant_BitSelectorMask[32]{
-                0x01, 0x02, 0x04, 0x08,
-                0x10, 0x20, 0x40, 0x80,
-                0x01, 0x02, 0x04, 0x08,
-                0x10, 0x20, 0x40, 0x80,
-                0x01, 0x02, 0x04, 0x08,
-                0x10, 0x20, 0x40, 0x80,
-                0x01, 0x02, 0x04, 0x08,
-                0x10, 0x20, 0x40, 0x80,
-            };
-
-            static constexpr ice::postcard::u8 Constant_LSBChannelClearMask[32]{
-                0xfe, 0xfe, 0xfe, 0xfe,
-                0xfe, 0xfe, 0xfe, 0xfe,
-                0xfe, 0xfe, 0xfe, 0xfe,
-                0xfe, 0xfe, 0xfe, 0xfe,
-                0xfe, 0xfe, 0xfe, 0xfe,
-                0xfe, 0xfe, 0xfe, 0xfe,
-                0xfe, 0xfe, 0xfe, 0xfe,
-                0xfe, 0xfe, 0xfe, 0xfe,
-            };
-
-            static constexpr ice::postcard::u8 Constant_LSBChannelKeepMask[32]{
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-                0x01, 0x01, 0x01, 0x01,
-            };
-
-        } // namespace simd
-
-    } // namespace detail
+    auto Attachment::operator=(Attachment&& other) noexcept -> Attachment&
+    {
+        if (this != &other)
+        {
+            std::swap(_allocator, other._allocator);
+            std::swap(_data, other._data);
+        }
+        return *this;
+    }
 
     static constexpr ice::postcard::u8 Constant_UsedChannels[]{ 0, 1, 2 }; // 0=r, 1=g, 2=b, 3=a
     static constexpr ice::postcard::u32 Constant_ChannelsUsedPerByte = sizeof(ice::postcard::u8) * 8;
 
     struct PostcardHeader
     {
-        static constexpr ice::postcard::u32 Constant_Magic = 'ISPC';
+        static constexpr ice::postcard::u32 Constant_Magic = 0x49'53'50'43; // 'ISPC'
+        static constexpr ice::postcard::u16 Flag_Compressed = 0x0001;
+        static constexpr ice::postcard::u16 Flag_Density2 = 0x0002;
+        static constexpr ice::postcard::u16 Flag_Density4 = 0x0004;
+        static constexpr ice::postcard::u16 Flag_Checksum = 0x0008;
+        static constexpr ice::postcard::u16 Flag_Entries = 0x0010;
+        static constexpr ice::postcard::u16 Flag_Size64 = 0x0020;
+        static constexpr ice::postcard::u16 Flag_Shard = 0x0040;
         ice::postcard::u32 magic = Constant_Magic;
-        ice::postcard::u16 unused;
+        ice::postcard::u16 flags;
         ice::postcard::u16 revision;
         ice::postcard::u32 attachment_size;
+
+        // Only stored if 'Flag_Size64' is set, which is only done for attachments of 4 GiB and more.
+        //   Smaller attachments keep the 12 byte header, so their postcards don't change.
+        ice::postcard::u32 attachment_size_high = 0;
     };
 
-    auto capacity(ice::postcard::Image const& image) noexcept -> ice::postcard::usize
+    // Follows the header if 'Flag_Compressed' is set, 'attachment_size' then holds the uncompressed size.
+    //   Unlike the header, which always uses one bit per channel, it is stored with the density of the attachment.
+    struct PostcardCompression
     {
-        ice::postcard::usize const total_available_bytes = ((image.width * image.height * std::size(Constant_UsedChannels)) / Constant_ChannelsUsedPerByte);
-        return total_available_bytes - sizeof(PostcardHeader);
-    }
+        ice::postcard::u32 compressed_size;
+    };
 
-    auto write(
-        ice::postcard::Image& image,
-        ice::postcard::PostcardInfo const& info,
-        ice::postcard::Attachment const& attachment
-    ) noexcept -> ice::postcard::Result
+    // Follows the attachment if 'Flag_Checksum' is set, stored with the density of the attachment.
+    //   The CRC32C covers the header, the compression header and all embedded attachment bytes.
+    struct PostcardChecksum
     {
-        return write(image, info, ice::postcard::Data{ attachment._data.location, attachment._data.size });
-    }
+        ice::postcard::u32 crc32c;
+    };
 
-    auto write(
-        ice::postcard::Image& image,
-        ice::postcard::PostcardInfo const& info,
-        ice::postcard::Data const& attachment_data
-    ) noexcept -> ice::postcard::Result
+    // Starts the attachment if 'Flag_Entries' is set, followed by 'entry_count' entries sorted by ID and the entry data.
+    //   Entries are never compressed, so each one can be located the same way as a range of the attachment.
+    struct PostcardTable
     {
-        using ice::postcard::Result;
-        assert(info.attachment_size == 0 || info.attachment_size == attachment_data.size);
+        ice::postcard::u32 entry_count;
+    };
+
+    static_assert(sizeof(PostcardEntryInfo) == 16, "Entries are stored in the image as they are laid out in memory.");
+
+    // If 'Flag_Shard' is set, the attachment starts with the shard info and then holds its part of the whole attachment.
+    static_assert(sizeof(PostcardShardInfo) == 32, "Shards are stored in the image as they are laid out in memory.");
+
+    // Size of the header without 'attachment_size_high'.
+    static constexpr ice::postcard::usize Constant_HeaderSize = offsetof(PostcardHeader, attachment_size_high);
+    static constexpr ice::postcard::usize Constant_HeaderChannels = Constant_HeaderSize * Constant_ChannelsUsedPerByte;
+
+    // Checksums are updated after each chunk is embedded or extracted, while its bytes are still in cache.
+    //   The size is a multiple of every SIMD block, so chunks never leave a remainder for the scalar path.
+    static constexpr ice::postcard::usize Constant_ChecksumChunkSize = 3 * 1024;
+
+    // Stripes are a multiple of this size, so each one starts on a pixel boundary and on a whole SIMD block.
+    static constexpr ice::postcard::usize Constant_StripeAlignment = 192;
+    // Batches are split into a few groups of jobs per thread, so uneven jobs still balance out without a task for each job.
+    static constexpr ice::postcard::u32 Constant_BatchGroupsPerThread = 4;
+
+    // Attachments extracted by 'read_batch' start at this alignment in the shared allocation.
+    static constexpr ice::postcard::usize Constant_BatchSlotAlignment = 16;
+
+    static constexpr ice::postcard::usize Constant_StripeMinSize = 64 * 1024;
 
-        if (capacity(image) < attachment_data.size)
+    namespace detail
+    {
+
+        //! \brief Returns the image offset of the given used channel, skipping alpha on images with 4 channels.
+        static auto channel_offset(
+            ice::postcard::u8 channel_count,
+            ice::postcard::usize channel,
+            ice::postcard::u8& out_last_channel
+        ) noexcept -> ice::postcard::usize
         {
-            return Result::ErrorWrite_AttachmentTooBig;
+            if (channel_count == 4)
+            {
+                out_last_channel = ice::postcard::u8(channel % 3);
+                return (channel / 3) * 4 + out_last_channel;
+            }
+
+            out_last_channel = 0;
+            return channel;
         }
 
-        PostcardHeader const header{
-            .revision = info.revision,
-            .attachment_size = ice::postcard::u32(attachment_data.size)
-        };
+        //! \brief Number of bytes taken by a single pixel.
+        static auto pixel_size(ice::postcard::Image const& image) noexcept -> ice::postcard::usize
+        {
+            return ice::postcard::usize(image.channels) * ice::postcard::usize(image.depth);
+        }
 
-        ice::postcard::u8 last_channel_written = 0;
-        ice::postcard::usize const offset = detail::write_postcard_data(
-            image.data,
-            { &header, sizeof(header) },
-            image.channels,
-            last_channel_written
-        );
-        detail::write_postcard_data(
-            { reinterpret_cast<ice::postcard::u8*>(image.data.location) + offset, image.data.size - offset },
-            attachment_data,
-            image.channels,
-            last_channel_written
-        );
-        return Result::Success;
-    }
+        //! \brief Number of channels that can hold data, calculated in 64 bits as gigapixel images would overflow 32 bits.
+        static auto total_channels(ice::postcard::Image const& image) noexcept -> ice::postcard::u64
+        {
+            return ice::postcard::u64(image.width) * image.height * std::size(Constant_UsedChannels);
+        }
 
-    auto read_info(
-        ice::postcard::Image const& image,
-        ice::postcard::PostcardInfo& out_info
-    ) noexcept -> ice::postcard::Result
-    {
-        using ice::postcard::Result;
+        //! \brief Number of bytes between the starts of two consecutive rows.
+        static auto row_stride(ice::postcard::Image const& image) noexcept -> ice::postcard::usize
+        {
+            return image.row_stride != 0 ? image.row_stride : image.width * pixel_size(image);
+        }
 
-        PostcardHeader header{ };
-        ice::postcard::u8 last_channel_read = 0;
-        detail::read_postcard_data(
-            { &header, sizeof(header) },
-            { image.data.location, image.data.size },
-            image.channels,
-            last_channel_read
-        );
+        //! \brief Number of used channels stored without gaps, a single row or the whole image if rows are tightly packed.
+        static auto contiguous_channels(ice::postcard::Image const& image) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::usize const row_channels = ice::postcard::usize(image.width) * std::size(Constant_UsedChannels);
+            return row_stride(image) == image.width * pixel_size(image) ? row_channels * image.height : row_channels;
+        }
 
-        if (header.magic != PostcardHeader::Constant_Magic)
+        //! \brief Returns the offset into 'image.data' of the given used channel, taking the row stride into account.
+        static auto image_offset(
+            ice::postcard::Image const& image,
+            ice::postcard::usize channel,
+            ice::postcard::u8& out_last_channel
+        ) noexcept -> ice::postcard::usize
         {
-            return Result::ErrorRead_AttachmentNotFound;
+            ice::postcard::usize const run = contiguous_channels(image);
+            ice::postcard::usize const row_offset = channel_offset(image.channels, channel % run, out_last_channel);
+            return (channel / run) * row_stride(image) + row_offset * ice::postcard::usize(image.depth);
         }
 
-        out_info.revision = header.revision;
-        out_info.attachment_size = header.attachment_size;
-        return Result::Success;
-    }
+        //! \brief Returns the number of bits per channel, or zero if the flags hold an unknown density.
+        static auto density_bits(ice::postcard::PostcardHeader const& header) noexcept -> ice::postcard::u8
+        {
+            switch (header.flags & (PostcardHeader::Flag_Density2 | PostcardHeader::Flag_Density4))
+            {
+            case 0: return 1;
+            case PostcardHeader::Flag_Density2: return 2;
+            case PostcardHeader::Flag_Density4: return 4;
+            default: return 0;
+            }
+        }
 
-    auto read(
-        ice::postcard::Image const& image,
-        ice::postcard::PostcardInfo& out_info,
-        ice::postcard::Attachment& out_attachment,
-        ice::postcard::Allocator& allocator /*= ice::postcard::Allocator::get_default()*/
-    ) noexcept -> ice::postcard::Result
-    {
-        Result const result = read(image, out_info, out_attachment._data, allocator);
-        if (result == Result::Success)
+        static bool is_postcard(ice::postcard::PostcardHeader const& header) noexcept
         {
-            out_attachment._allocator = &allocator;
+            return header.magic == PostcardHeader::Constant_Magic && density_bits(header) != 0;
         }
-        return result;
-    }
 
-    auto read(
-        ice::postcard::Image const& image,
-        ice::postcard::PostcardInfo& out_info,
-        ice::postcard::Memory& out_attachment_data,
-        ice::postcard::Allocator& allocator /*= ice::postcard::Allocator::get_default()*/
-    ) noexcept -> ice::postcard::Result
-    {
-        using ice::postcard::Result;
+        //! \brief Number of header bytes stored in the image, including the size extension if there is one.
+        static auto header_size(ice::postcard::PostcardHeader const& header) noexcept -> ice::postcard::usize
+        {
+            return (header.flags & PostcardHeader::Flag_Size64) != 0 ? sizeof(PostcardHeader) : Constant_HeaderSize;
+        }
 
-        PostcardHeader header{ };
-        ice::postcard::u8 last_channel_read = 0;
-        ice::postcard::usize const offset = detail::read_postcard_data(
-            { &header, sizeof(header) },
-            { image.data.location, image.data.size },
-            image.channels,
-            last_channel_read
-        );
+        //! \brief Uncompressed attachment size, including the upper bits stored with 'Flag_Size64'.
+        static auto attachment_size(ice::postcard::PostcardHeader const& header) noexcept -> ice::postcard::u64
+        {
+            ice::postcard::u64 const high = (header.flags & PostcardHeader::Flag_Size64) != 0 ? header.attachment_size_high : 0;
+            return (high << 32) | header.attachment_size;
+        }
 
-        if (header.magic != PostcardHeader::Constant_Magic)
+        //! \brief Number of used channels holding a single attachment byte.
+        static auto channels_per_byte(ice::postcard::u8 bits) noexcept -> ice::postcard::usize
         {
-            return Result::ErrorRead_AttachmentNotFound;
+            return Constant_ChannelsUsedPerByte / bits;
         }
 
-        ice::postcard::Memory result = allocator.allocate(header.attachment_size);
-        detail::read_postcard_data(
-            result,
-            { reinterpret_cast<ice::postcard::u8 const*>(image.data.location) + offset,  image.data.size - offset },
-            image.channels,
-            last_channel_read
-        );
+        //! \brief Checks the image has room for the header and the checksum, so it can hold at least an empty attachment.
+        static bool holds_postcard(ice::postcard::Image const& image, ice::postcard::Density density) noexcept
+        {
+            return total_channels(image) >= Constant_HeaderChannels + sizeof(PostcardChecksum) * channels_per_byte(ice::postcard::u8(density));
+        }
 
-        out_info.revision = header.revision;
-        out_info.attachment_size = header.attachment_size;
-        out_attachment_data = result;
-        return Result::Success;
-    }
+        //! \brief Writes 'source' into the image, starting at used channel 'channel'.
+        //! \details Each row is passed to the kernels separately, unless rows are tightly packed.
+        //!   A byte split between two rows is written one channel at a time.
+        //! \returns The used channel following the last written byte.
+        static auto write_image_data(
+            ice::postcard::Image const& image,
+            ice::postcard::usize channel,
+            ice::postcard::Data source,
+            ice::postcard::u8 bits
+        ) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::usize const run = contiguous_channels(image);
+            ice::postcard::usize const per_byte = channels_per_byte(bits);
+            ice::postcard::u8 const value_mask = ice::postcard::u8((1 << bits) - 1);
+            ice::postcard::u8* const pixels = reinterpret_cast<ice::postcard::u8*>(image.data.location);
+            ice::postcard::u8 const* bytes = reinterpret_cast<ice::postcard::u8 const*>(source.location);
+            ice::postcard::u8 const* const bytes_end = bytes + source.size;
+
+            while (bytes < bytes_end)
+            {
+                ice::postcard::u8 last_channel;
+                ice::postcard::usize const count = std::min<ice::postcard::usize>(bytes_end - bytes, (run - channel % run) / per_byte);
+                if (count > 0)
+                {
+                    ice::postcard::usize const offset = image_offset(image, channel, last_channel);
+                    detail::write_postcard_data({ pixels + offset, image.data.size - offset }, { bytes, count }, image.channels, ice::postcard::u8(image.depth), bits, last_channel);
+                    channel += count * per_byte;
+                    bytes += count;
+                    continue;
+                }
 
-#if ICE_POSTCARD_SIMD_ENABLED
-    auto detail::simd::write_postcard_data(
-        ice::postcard::Memory target,
-        ice::postcard::Data source,
-        ice::u8 channel_count,
-        ice::u8& out_last_written_channel
-    ) noexcept -> ice::usize
-    {
-        // Used to calculate final offset after all data is written.
-        ice::u16 const* const source_words = reinterpret_cast<ice::u16 const*>(source.location);
-        ice::u8* destination = reinterpret_cast<ice::u8*>(target.location);
-        ice::u8 const* const start = destination;
-
-        static __m128i const sse_mask_copy = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentCopyMask));
-        static __m128i const sse_mask_select = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_BitSelectorMask));
-        static __m128i const sse_mask_lsb_clear = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelClearMask));
-        static __m128i const sse_mask_lsb_keep = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelKeepMask));
-
-        ice::usize const simd_sse_words = source.size / 2;
-        for (ice::usize word_idx = 0; word_idx < simd_sse_words; word_idx += 1)
-        {
-            // Load the given word.
-            __m128i v = _mm_set1_epi16(*(source_words + word_idx));
-            // Duplicate both bytes into lower and higher half of the register for 8 entries each (8 bits sxtracted).
-            v = _mm_shuffle_epi8(v, sse_mask_copy);
-            // Keep only the required bit for each 8bit entry and check if it is set
-            v = _mm_and_si128(v, sse_mask_select);
-            v = _mm_cmpeq_epi8(v, sse_mask_select);
-            // Keep only the LSB bit after the check
-            v = _mm_and_si128(v, sse_mask_lsb_keep);
-
-            if (channel_count == 3)
-            {
-                // Load 16 bytes into the register from the image.
-                __m128i imgchan = _mm_loadu_si128(reinterpret_cast<__m128i const*>(destination));
-                // Clear the LSB bit so we can set it with out own data.
-                imgchan = _mm_and_si128(imgchan, sse_mask_lsb_clear);
-                // Add the prevously caclulated data
-                imgchan = _mm_add_epi8(imgchan, v);
-                // Store back the result into the buffer
-                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), imgchan);
-
-                // Move to the next destination
-                destination += 16;
+                for (ice::postcard::u8 shift = 0; shift < 8; shift += bits, channel += 1)
+                {
+                    ice::postcard::u8& value = pixels[image_offset(image, channel, last_channel)];
+                    value = ice::postcard::u8((value & ~value_mask) | ((bytes[0] >> shift) & value_mask));
+                }
+                bytes += 1;
             }
-            else
+            return channel;
+        }
+
+        //! \brief Reads 'target.size' bytes from the image, starting at used channel 'channel'.
+        //! \returns The used channel following the last read byte.
+        static auto read_image_data(
+            ice::postcard::Image const& image,
+            ice::postcard::usize channel,
+            ice::postcard::Memory target,
+            ice::postcard::u8 bits
+        ) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::usize const run = contiguous_channels(image);
+            ice::postcard::usize const per_byte = channels_per_byte(bits);
+            ice::postcard::u8 const value_mask = ice::postcard::u8((1 << bits) - 1);
+            ice::postcard::u8 const* const pixels = reinterpret_cast<ice::postcard::u8 const*>(image.data.location);
+            ice::postcard::u8* bytes = reinterpret_cast<ice::postcard::u8*>(target.location);
+            ice::postcard::u8* const bytes_end = bytes + target.size;
+
+            while (bytes < bytes_end)
             {
-                ice::u8 temp[16];
-                _mm_storeu_si128((__m128i*)temp, v);
+                ice::postcard::u8 last_channel;
+                ice::postcard::usize const count = std::min<ice::postcard::usize>(bytes_end - bytes, (run - channel % run) / per_byte);
+                if (count > 0)
+                {
+                    ice::postcard::usize const offset = image_offset(image, channel, last_channel);
+                    detail::read_postcard_data({ bytes, count }, { pixels + offset, image.data.size - offset }, image.channels, ice::postcard::u8(image.depth), bits, last_channel);
+                    channel += count * per_byte;
+                    bytes += count;
+                    continue;
+                }
 
-                for (ice::u8 new_lsb : temp)
+                bytes[0] = 0;
+                for (ice::postcard::u8 shift = 0; shift < 8; shift += bits, channel += 1)
                 {
-                    if (out_last_written_channel == 3)
-                    {
-                        destination += 1;
-                        out_last_written_channel = 0;
-                    }
-                    destination[0] = (destination[0] & detail::simd::Constant_LSBChannelClearMask[0]) | new_lsb;
-                    out_last_written_channel += 1;
-                    destination += 1;
+                    bytes[0] |= ice::postcard::u8((pixels[image_offset(image, channel, last_channel)] & value_mask) << shift);
                 }
+                bytes += 1;
             }
+            return channel;
         }
-        return reinterpret_cast<ice::u8 const*>(destination) - reinterpret_cast<ice::u8 const*>(start);
-    }
 
-    auto detail::simd::read_postcard_data(
-        ice::postcard::Memory& target,
-        ice::postcard::Data source,
-        ice::u8 channel_count,
-        ice::u8& out_last_read_channel
-    ) noexcept -> ice::usize
-    {
-        // Used to calculate final offset after all data is written.
-        ice::u8 const* const source_words = reinterpret_cast<ice::u8 const*>(source.location);
-        ice::u8* destination = reinterpret_cast<ice::u8*>(target.location);
-        ice::u8 const* const start = destination;
-
-        static __m128i const sse_mask_copy = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentCopyMask));
-        static __m128i const sse_mask_select = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_BitSelectorMask));
-        static __m128i const sse_mask_lsb_clear = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelClearMask));
-        static __m128i const sse_mask_lsb_keep = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelKeepMask));
-
-        ice::usize bytes_to_read = target.size;
-        ice::usize byte_offset = 0;
-        // If we don't have at least 3 bytes to read (case when channel_count == 4)
-        //   we leave this function and allow the rest to be read with the non-simd version.
-        while (bytes_to_read >= 3)
-        {
-            // Load 32 bytes into registers from the image.
-            __m128i v0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source_words + byte_offset));
-            __m128i v1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source_words + byte_offset + 16));
-
-            // Keep the last bit only
-            v0 = _mm_and_si128(v0, sse_mask_lsb_keep);
-            v1 = _mm_and_si128(v1, sse_mask_lsb_keep);
-
-            // Compare the bits with keep mask, which will set also the msb we want to use in the next operation.
-            v0 = _mm_cmpeq_epi8(v0, sse_mask_lsb_keep);
-            v1 = _mm_cmpeq_epi8(v1, sse_mask_lsb_keep);
-
-            // Creates a 'mask' out of the bits we have loaded. Which results in the final two bytes we wanted to read.
-            ice::u16 const temp0 = _mm_movemask_epi8(v0);
-            ice::u16 const temp1 = _mm_movemask_epi8(v1);
-
-            ice::u8 const* temp0u8 = reinterpret_cast<ice::u8 const*>(&temp0);
-            ice::u8 const* temp1u8 = reinterpret_cast<ice::u8 const*>(&temp1);
-            if (channel_count == 4)
+        //! \brief Index of the used channel holding the first attachment byte.
+        static auto payload_channel(ice::postcard::PostcardHeader const& header) noexcept -> ice::postcard::usize
+        {
+            bool const compressed = (header.flags & PostcardHeader::Flag_Compressed) != 0;
+            return header_size(header) * Constant_ChannelsUsedPerByte
+                + (compressed ? sizeof(PostcardCompression) * channels_per_byte(density_bits(header)) : 0);
+        }
+
+        //! \brief Writes the header, followed by the compression header if 'compressed_size' is not zero.
+        //! \returns The used channel following the written headers.
+        static auto write_header(
+            ice::postcard::Image& image,
+            ice::postcard::PostcardInfo const& info,
+            ice::postcard::usize attachment_size,
+            ice::postcard::usize compressed_size,
+            ice::postcard::u32& out_checksum,
+            ice::postcard::u16 extra_flags = 0
+        ) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::u16 flags = PostcardHeader::Flag_Checksum | extra_flags;
+            if (ice::postcard::u64(attachment_size) > std::numeric_limits<ice::postcard::u32>::max())
+            {
+                flags |= PostcardHeader::Flag_Size64;
+            }
+            if (compressed_size > 0)
+            {
+                flags |= PostcardHeader::Flag_Compressed;
+            }
+            if (info.density == Density::Bits2)
+            {
+                flags |= PostcardHeader::Flag_Density2;
+            }
+            else if (info.density == Density::Bits4)
+            {
+                flags |= PostcardHeader::Flag_Density4;
+            }
+
+            PostcardHeader const header{
+                .flags = flags,
+                .revision = info.revision,
+                .attachment_size = ice::postcard::u32(attachment_size),
+                .attachment_size_high = ice::postcard::u32(ice::postcard::u64(attachment_size) >> 32),
+            };
+
+            out_checksum = detail::crc::crc32c(0, { &header, header_size(header) });
+            ice::postcard::usize channel = detail::write_image_data(image, 0, { &header, header_size(header) }, 1);
+
+            if (compressed_size > 0)
             {
-                assert(false);
-                // TODO: Fix reading data with simd using 4 channels
-                //destination[0] = temp0u8[0];
-                //destination[1] = (0xf0 & temp0u8[1]) | (temp1u8[0] & 0x0f);
-                //destination[2] = temp1u8[1];
-                //destination[0] = (temp0 & 0x00'07) | ((temp0 & 0x00'70) >> 1) | ((temp0 & 0x03'00) >> 2);
-                //destination[1] = ((temp0 & 0x04'00) >> 10) | ((temp0 & 0x70'00) >> 11) | ((temp1 & 0x00'07) << 4) | ((temp1 & 0x00'10) << 3);
-                //destination[2] = ((temp1 & 0x00'60) >> 5) | ((temp1 & 0x07'00) >> 6) | ((temp1 & 0x70'00) >> 8);
-                //destination += 3;
-                //bytes_to_read -= 3;
+                PostcardCompression const compression{ .compressed_size = ice::postcard::u32(compressed_size) };
+                out_checksum = detail::crc::crc32c(out_checksum, { &compression, sizeof(compression) });
+                channel = detail::write_image_data(image, channel, { &compression, sizeof(compression) }, ice::postcard::u8(info.density));
             }
-            else // if (channel_count == 3)
+            return channel;
+        }
+
+        //! \brief Reads the header, followed by the compression header if the postcard is compressed.
+        //! \returns The used channel following the read headers.
+        static auto read_header(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader& out_header,
+            ice::postcard::PostcardCompression& out_compression
+        ) noexcept -> ice::postcard::usize
+        {
+            out_header.attachment_size_high = 0;
+            ice::postcard::usize channel = detail::read_image_data(image, 0, { &out_header, Constant_HeaderSize }, 1);
+            if (is_postcard(out_header) && (out_header.flags & PostcardHeader::Flag_Size64) != 0)
             {
-                destination[0] = temp0u8[0];
-                destination[1] = temp0u8[1];
-                destination[2] = temp1u8[0];
-                destination[3] = temp1u8[1];
-                destination += 4;
-                bytes_to_read -= 4;
+                channel = detail::read_image_data(
+                    image, channel, { &out_header.attachment_size_high, sizeof(out_header.attachment_size_high) }, 1
+                );
             }
 
-            byte_offset += 32;
+            out_compression.compressed_size = 0;
+            if (is_postcard(out_header) && (out_header.flags & PostcardHeader::Flag_Compressed) != 0)
+            {
+                channel = detail::read_image_data(image, channel, { &out_compression, sizeof(out_compression) }, density_bits(out_header));
+            }
+            return channel;
         }
 
-        target.location = destination;
-        target.size -= ice::usize(destination - start);
-        return byte_offset;
-    }
-#endif // #if ICE_POSTCARD_SIMD_ENABLED
+        static auto postcard_info(
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression
+        ) noexcept -> ice::postcard::PostcardInfo
+        {
+            bool const compressed = (header.flags & PostcardHeader::Flag_Compressed) != 0;
+            return PostcardInfo{
+                .revision = header.revision,
+                .attachment_size = attachment_size(header),
+                .compression = compressed ? Compression::LZ : Compression::None,
+                .compressed_size = compressed ? compression.compressed_size : 0,
+                .density = ice::postcard::Density(density_bits(header)),
+                .has_checksum = (header.flags & PostcardHeader::Flag_Checksum) != 0,
+                .has_entries = (header.flags & PostcardHeader::Flag_Entries) != 0,
+                .is_shard = (header.flags & PostcardHeader::Flag_Shard) != 0,
+            };
+        }
 
-    auto detail::write_postcard_data(
-        ice::postcard::Memory target,
-        ice::postcard::Data source,
-        ice::postcard::u8 channel_count,
-        ice::postcard::u8& out_last_written_channel
-    ) noexcept -> ice::postcard::usize
-    {
-        ice::postcard::usize offset = 0;
-        if constexpr (detail::simd::Constant_EnabledSIMD)
+        //! \brief Checks that 'memory' holds at least 'size' bytes, a block that is too small is given back right away.
+        static bool allocated(
+            ice::postcard::Allocator& allocator,
+            ice::postcard::Memory memory,
+            ice::postcard::usize size
+        ) noexcept
         {
-            ice::postcard::usize const remainder_bytes = source.size & 0x0000'0003;
-            ice::postcard::usize const simd_write_size = source.size - remainder_bytes;
-            if (simd_write_size > 0)
+            if (size == 0 || (memory.location != nullptr && memory.size >= size))
+            {
+                return true;
+            }
+            if (memory.location != nullptr)
             {
-                source.size = simd_write_size;
-                offset = detail::simd::write_postcard_data(target, source, channel_count, out_last_written_channel);
-                target.location = reinterpret_cast<ice::postcard::u8*>(target.location) + offset;
-                target.size -= offset;
-                source.location = reinterpret_cast<ice::postcard::u8 const*>(source.location) + simd_write_size;
-                source.size = remainder_bytes;
+                allocator.deallocate(memory);
             }
+            return false;
         }
 
-        if (source.size > 0)
+        //! \brief Compresses the attachment if the result is smaller and still fits into 'capacity' bytes.
+        //! \returns The memory holding the compressed data, or an empty block if the attachment should be stored as is.
+        static auto compress_attachment(
+            ice::postcard::Data attachment,
+            ice::postcard::usize capacity,
+            ice::postcard::Allocator& allocator,
+            ice::postcard::usize& out_compressed_size
+        ) noexcept -> ice::postcard::Memory
         {
-            // Temporary buffer holding 8 bytes extracted from each bit from an single source byte.
-            ice::postcard::u8 temp[8];
+            out_compressed_size = 0;
+            if (attachment.size == 0 || capacity <= sizeof(PostcardCompression))
+            {
+                return { };
+            }
 
-            // Used to calculate final offset after all data is written.
-            ice::postcard::u8* destination = reinterpret_cast<ice::postcard::u8*>(target.location);
-            ice::postcard::u8 const* const start = destination;
+            // Match positions and the compressed size are 32 bit values, larger attachments are stored as is.
+            if (ice::postcard::u64(attachment.size) > std::numeric_limits<ice::postcard::u32>::max())
+            {
+                return { };
+            }
 
-            for (ice::postcard::u8 byte : std::span{ reinterpret_cast<ice::postcard::u8 const*>(source.location), source.size })
+            // There is no point in producing more data than we can embed or more than the attachment itself.
+            ice::postcard::usize const limit = std::min(attachment.size - 1, capacity - sizeof(PostcardCompression));
+            ice::postcard::Memory const result = detail::stats::allocate(allocator, limit);
+            if (allocated(allocator, result, limit) == false)
             {
-                temp[0] = (byte & 0b0000'0001) >> 0;
-                temp[1] = (byte & 0b0000'0010) >> 1;
-                temp[2] = (byte & 0b0000'0100) >> 2;
-                temp[3] = (byte & 0b0000'1000) >> 3;
-                temp[4] = (byte & 0b0001'0000) >> 4;
-                temp[5] = (byte & 0b0010'0000) >> 5;
-                temp[6] = (byte & 0b0100'0000) >> 6;
-                temp[7] = (byte & 0b1000'0000) >> 7;
+                return { };
+            }
 
-                // For images with 4 channels we skip alpha when embedding data.
-                if (channel_count == 4)
-                {
-                    for (ice::postcard::u8 new_lsb : temp)
-                    {
-                        if (out_last_written_channel == 3)
-                        {
-                            destination += 1;
-                            out_last_written_channel = 0;
-                        }
-                        destination[0] = (destination[0] & detail::simd::Constant_LSBChannelClearMask[0]) | new_lsb;
-                        out_last_written_channel += 1;
-                        destination += 1;
-                    }
-                }
-                else
-                {
-                    for (ice::postcard::u8 new_lsb : temp)
-                    {
-                        destination[0] = (destination[0] & detail::simd::Constant_LSBChannelClearMask[0]) | new_lsb;
-                        destination += 1;
-                    }
-                }
+            out_compressed_size = detail::lz::compress(attachment, result);
+            if (out_compressed_size == 0)
+            {
+                allocator.deallocate(result);
+                return { };
             }
-            offset += ice::postcard::usize(destination - start);
+            return result;
         }
-        return offset;
-    }
 
-    auto detail::read_postcard_data(
-        ice::postcard::Memory target,
-        ice::postcard::Data source,
-        ice::postcard::u8 channel_count,
-        ice::postcard::u8& out_last_read_channel
-    ) noexcept -> ice::postcard::usize
-    {
-        ice::postcard::usize offset = 0;
-        if constexpr (detail::simd::Constant_EnabledSIMD)
+        //! \brief Number of attachment bytes that need to be embedded, including the compression header.
+        //! \details Attachments of 4 GiB and more also count the header size extension, which 'capacity' leaves out.
+        static auto embedded_size(
+            ice::postcard::usize attachment_size,
+            ice::postcard::usize compressed_size,
+            ice::postcard::Density density
+        ) noexcept -> ice::postcard::usize
         {
-            ice::postcard::usize const total_source_size = source.size;
-            ice::postcard::usize const remainder_bytes = target.size & 0x0000'0003;
-            ice::postcard::usize const simd_read_size = target.size - remainder_bytes;
-
-            // TODO: Images with 4 channels, where 'alpha' is ignored do not support simd read, we might want to fix that at some point.
-            if (simd_read_size > 0 && channel_count == 3)
+            if (compressed_size > 0)
+            {
+                return compressed_size + sizeof(PostcardCompression);
+            }
+            if (ice::postcard::u64(attachment_size) > std::numeric_limits<ice::postcard::u32>::max())
             {
-                assert(total_source_size > (simd_read_size + remainder_bytes) * 8);
-                offset = detail::simd::read_postcard_data(target, source, channel_count, out_last_read_channel);
-                source.location = reinterpret_cast<ice::postcard::u8 const*>(source.location) + offset;
-                source.size -= offset;
+                // The extension is stored with one bit per channel, so it takes 'density' times its size in attachment bytes.
+                return attachment_size + sizeof(PostcardHeader::attachment_size_high) * ice::postcard::usize(density);
             }
+            return attachment_size;
         }
 
-        if (target.size > 0)
+        //! \brief Checks 'embedded_size' bytes fit into the image, next to the header and the checksum.
+        static bool fits_capacity(
+            ice::postcard::Image const& image,
+            ice::postcard::Density density,
+            ice::postcard::usize embedded_size
+        ) noexcept
         {
-            // Used to calculate final offset after all data is written.
-            ice::postcard::u8* destination = reinterpret_cast<ice::postcard::u8*>(target.location);
-            ice::postcard::u8 const* source_bytes = reinterpret_cast<ice::postcard::u8 const*>(source.location);
-            ice::postcard::u8 const* const source_bytes_start = source_bytes;
+            // Images too small for any postcard report no capacity, which an empty attachment would still fit into.
+            return holds_postcard(image, density) && embedded_size <= capacity(image, density);
+        }
 
-            for (ice::postcard::u32 idx = 0; idx < target.size; idx += 1)
+        //! \brief Checksum of the header and the compression header, as they were stored in the image.
+        static auto header_checksum(
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression
+        ) noexcept -> ice::postcard::u32
+        {
+            ice::postcard::u32 const result = detail::crc::crc32c(0, { &header, header_size(header) });
+            if ((header.flags & PostcardHeader::Flag_Compressed) == 0)
             {
-                // Temporary byte holding a single byte extracted from 8 attachment byte LSB value.
-                ice::postcard::u8 temp = 0;
+                return result;
+            }
+            return detail::crc::crc32c(result, { &compression, sizeof(compression) });
+        }
 
-                if (channel_count == 4)
-                {
-                    for (ice::postcard::u8 bytes_read = 0; bytes_read < 8; bytes_read += 1, source_bytes += 1, out_last_read_channel += 1)
-                    {
-                        if (out_last_read_channel == 3)
-                        {
-                            source_bytes += 1;
-                            out_last_read_channel = 0;
-                        }
+        //! \brief Number of attachment bytes stored in the image, not counting the compression header.
+        static auto stored_size(
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression
+        ) noexcept -> ice::postcard::u64
+        {
+            return (header.flags & PostcardHeader::Flag_Compressed) != 0 ? compression.compressed_size : attachment_size(header);
+        }
 
-                        temp |= (source_bytes[0] & detail::simd::Constant_LSBChannelKeepMask[0]) << bytes_read;
-                    }
-                }
-                else
-                {
-                    for (ice::postcard::u8 source_byte : std::span{ source_bytes, 8 })
-                    {
-                        temp <<= 1;
-                        temp |= (source_byte & detail::simd::Constant_LSBChannelKeepMask[0]);
-                    }
+        //! \brief Index of the used channel holding the checksum, directly after the last attachment byte.
+        static auto checksum_channel(
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression
+        ) noexcept -> ice::postcard::u64
+        {
+            return payload_channel(header) + stored_size(header, compression) * channels_per_byte(density_bits(header));
+        }
 
-                    source_bytes += 8;
-                }
-                destination[idx] = temp;
+        //! \brief Checks the postcard does not claim more channels than the image has, so a corrupted header can't make us read past it.
+        //! \details A compressed attachment also can't claim more than its stored data decompresses to, which bounds the memory
+        //!   allocated for it before the checksum is verified.
+        static bool fits_image(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression
+        ) noexcept
+        {
+            if ((header.flags & PostcardHeader::Flag_Compressed) != 0
+                && attachment_size(header) > lz::max_decompressed_size(compression.compressed_size))
+            {
+                return false;
             }
 
-            offset += ice::postcard::usize(source_bytes - source_bytes_start);
+            ice::postcard::u64 const checksum_channels = (header.flags & PostcardHeader::Flag_Checksum) != 0
+                ? sizeof(PostcardChecksum) * channels_per_byte(density_bits(header))
+                : 0;
+            return checksum_channel(header, compression) + checksum_channels <= total_channels(image);
         }
-        return offset;
+
+        static void write_checksum(
+            ice::postcard::Image& image,
+            ice::postcard::usize channel,
+            ice::postcard::u8 bits,
+            ice::postcard::u32 checksum
+        ) noexcept
+        {
+            PostcardChecksum const stored{ .crc32c = checksum };
+            detail::write_image_data(image, channel, { &stored, sizeof(stored) }, bits);
+        }
+
+        static auto read_checksum(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression
+        ) noexcept -> ice::postcard::u32
+        {
+            PostcardChecksum stored{ };
+            detail::read_image_data(image, checksum_channel(header, compression), { &stored, sizeof(stored) }, density_bits(header));
+            return stored.crc32c;
+        }
+
+        //! \brief Reads 'target.size' bytes of an uncompressed attachment, starting at 'offset'.
+        static void read_attachment_range(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::usize offset,
+            ice::postcard::Memory target
+        ) noexcept
+        {
+            // Every payload byte takes a fixed number of channels, so we can seek directly to the requested one.
+            ice::postcard::u8 const bits = density_bits(header);
+            detail::read_image_data(image, payload_channel(header) + offset * channels_per_byte(bits), target, bits);
+        }
+
+        //! \brief Reads the header and the table of a postcard written with 'write_entries'.
+        static auto read_table(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader& out_header,
+            ice::postcard::PostcardTable& out_table
+        ) noexcept -> ice::postcard::Result
+        {
+            PostcardCompression compression{ };
+            detail::read_header(image, out_header, compression);
+
+            if (is_postcard(out_header) == false)
+            {
+                return Result::ErrorRead_AttachmentNotFound;
+            }
+            if ((out_header.flags & PostcardHeader::Flag_Entries) == 0)
+            {
+                return Result::ErrorRead_EntriesMissing;
+            }
+            if (compression.compressed_size > 0 || fits_image(image, out_header, compression) == false)
+            {
+                return Result::ErrorRead_AttachmentCorrupted;
+            }
+
+            out_table.entry_count = 0;
+            if (attachment_size(out_header) >= sizeof(PostcardTable))
+            {
+                read_attachment_range(image, out_header, 0, { &out_table, sizeof(out_table) });
+            }
+
+            ice::postcard::usize const table_size = sizeof(PostcardTable) + ice::postcard::usize(out_table.entry_count) * sizeof(PostcardEntryInfo);
+            if (table_size > attachment_size(out_header))
+            {
+                return Result::ErrorRead_AttachmentCorrupted;
+            }
+            return Result::Success;
+        }
+
+        //! \brief Searches the table for entry 'id', reading a single table entry per step.
+        static auto find_entry(
+            ice::postcard::Image const& image,
+            ice::postcard::u32 id,
+            ice::postcard::PostcardHeader& out_header,
+            ice::postcard::PostcardEntryInfo& out_entry
+        ) noexcept -> ice::postcard::Result
+        {
+            PostcardTable table{ };
+            Result const result = read_table(image, out_header, table);
+            if (result != Result::Success)
+            {
+                return result;
+            }
+
+            ice::postcard::u32 first = 0;
+            ice::postcard::u32 count = table.entry_count;
+            while (count > 0)
+            {
+                ice::postcard::u32 const step = count / 2;
+                PostcardEntryInfo entry{ };
+                read_attachment_range(
+                    image, out_header, sizeof(PostcardTable) + (first + step) * sizeof(PostcardEntryInfo), { &entry, sizeof(entry) }
+                );
+
+                if (entry.id == id)
+                {
+                    // A corrupted table could point outside of the attachment.
+                    if (entry.offset > attachment_size(out_header) || entry.size > attachment_size(out_header) - entry.offset)
+                    {
+                        return Result::ErrorRead_AttachmentCorrupted;
+                    }
+
+                    out_entry = entry;
+                    return Result::Success;
+                }
+
+                if (entry.id < id)
+                {
+                    first += step + 1;
+                    count -= step + 1;
+                }
+                else
+                {
+                    count = step;
+                }
+            }
+            return Result::ErrorRead_EntryNotFound;
+        }
+
+        //! \brief Same as 'write_image_data', but also continues the checksum 'crc' with the written bytes.
+        static auto write_image_data_checked(
+            ice::postcard::Image const& image,
+            ice::postcard::usize channel,
+            ice::postcard::Data source,
+            ice::postcard::u8 bits,
+            ice::postcard::u32& crc
+        ) noexcept -> ice::postcard::usize
+        {
+            for (ice::postcard::usize begin = 0; begin < source.size; begin += Constant_ChecksumChunkSize)
+            {
+                ice::postcard::Data const chunk{
+                    reinterpret_cast<ice::postcard::u8 const*>(source.location) + begin,
+                    std::min(Constant_ChecksumChunkSize, source.size - begin)
+                };
+
+                channel = detail::write_image_data(image, channel, chunk, bits);
+                crc = detail::crc::crc32c(crc, chunk);
+            }
+            return channel;
+        }
+
+        //! \brief Same as 'write_image_data_checked', but embeds 'part_count' parts back to back.
+        //! \details Parts are embedded in place as long as they fill a whole checksum chunk. Smaller pieces at part
+        //!   boundaries are gathered into a single chunk first, so the kernels don't fall back to scalar code for each part.
+        static auto write_image_data_gathered(
+            ice::postcard::Image const& image,
+            ice::postcard::usize channel,
+            ice::postcard::Data const* parts,
+            ice::postcard::u32 part_count,
+            ice::postcard::u8 bits,
+            ice::postcard::u32& crc
+        ) noexcept -> ice::postcard::usize
+        {
+            alignas(64) ice::postcard::u8 gathered[Constant_ChecksumChunkSize];
+            ice::postcard::usize gathered_size = 0;
+
+            for (ice::postcard::u32 idx = 0; idx < part_count; idx += 1)
+            {
+                if (parts[idx].size == 0)
+                {
+                    continue;
+                }
+
+                ice::postcard::u8 const* source = reinterpret_cast<ice::postcard::u8 const*>(parts[idx].location);
+                ice::postcard::usize remaining = parts[idx].size;
+
+                // Complete a started chunk before embedding anything in place, the bytes need to stay in order.
+                if (gathered_size > 0)
+                {
+                    ice::postcard::usize const taken = std::min(remaining, Constant_ChecksumChunkSize - gathered_size);
+                    std::memcpy(gathered + gathered_size, source, taken);
+                    gathered_size += taken;
+                    source += taken;
+                    remaining -= taken;
+
+                    if (gathered_size < Constant_ChecksumChunkSize)
+                    {
+                        continue;
+                    }
+                    channel = detail::write_image_data_checked(image, channel, { gathered, gathered_size }, bits, crc);
+                    gathered_size = 0;
+                }
+
+                ice::postcard::usize const whole_size = remaining - remaining % Constant_ChecksumChunkSize;
+                channel = detail::write_image_data_checked(image, channel, { source, whole_size }, bits, crc);
+
+                std::memcpy(gathered, source + whole_size, remaining - whole_size);
+                gathered_size = remaining - whole_size;
+            }
+            return detail::write_image_data_checked(image, channel, { gathered, gathered_size }, bits, crc);
+        }
+
+        //! \brief Same as 'read_image_data', but also continues the checksum 'crc' with the read bytes.
+        static auto read_image_data_checked(
+            ice::postcard::Image const& image,
+            ice::postcard::usize channel,
+            ice::postcard::Memory target,
+            ice::postcard::u8 bits,
+            ice::postcard::u32& crc
+        ) noexcept -> ice::postcard::usize
+        {
+            for (ice::postcard::usize begin = 0; begin < target.size; begin += Constant_ChecksumChunkSize)
+            {
+                ice::postcard::Memory const chunk{
+                    reinterpret_cast<ice::postcard::u8*>(target.location) + begin,
+                    std::min(Constant_ChecksumChunkSize, target.size - begin)
+                };
+
+                channel = detail::read_image_data(image, channel, chunk, bits);
+                crc = detail::crc::crc32c(crc, { chunk.location, chunk.size });
+            }
+            return channel;
+        }
+
+        struct StripedWrite
+        {
+            ice::postcard::Image image;
+            ice::postcard::Data payload;
+            ice::postcard::u8 bits;
+            ice::postcard::usize first_channel;
+            ice::postcard::usize stripe_size;
+            ice::postcard::u32* stripe_checksums;
+            ice::postcard::detail::stats::Counters* stats;
+        };
+
+        struct StripedRead
+        {
+            ice::postcard::Image image;
+            ice::postcard::Memory payload;
+            ice::postcard::u8 bits;
+            ice::postcard::usize first_channel;
+            ice::postcard::usize stripe_size;
+            ice::postcard::u32* stripe_checksums;
+            ice::postcard::detail::stats::Counters* stats;
+        };
+
+        static auto stripe_count(
+            ice::postcard::Executor& executor,
+            ice::postcard::usize payload_size,
+            ice::postcard::usize& out_stripe_size
+        ) noexcept -> ice::postcard::u32
+        {
+            out_stripe_size = 0;
+            if (payload_size == 0)
+            {
+                return 0;
+            }
+
+            ice::postcard::usize const max_stripes = std::max<ice::postcard::usize>(payload_size / Constant_StripeMinSize, 1);
+            ice::postcard::usize const stripes = std::clamp<ice::postcard::usize>(executor.concurrency(), 1, max_stripes);
+
+            ice::postcard::usize const stripe_size = (payload_size + stripes - 1) / stripes;
+            out_stripe_size = ((stripe_size + Constant_StripeAlignment - 1) / Constant_StripeAlignment) * Constant_StripeAlignment;
+            return ice::postcard::u32((payload_size + out_stripe_size - 1) / out_stripe_size);
+        }
+
+        static void write_stripe(void* userdata, ice::postcard::u32 stripe_index) noexcept
+        {
+            StripedWrite const& job = *reinterpret_cast<StripedWrite const*>(userdata);
+            detail::stats::Attach const stats_attach{ job.stats };
+            ice::postcard::usize const begin = stripe_index * job.stripe_size;
+            ice::postcard::usize const size = std::min(job.stripe_size, job.payload.size - begin);
+
+            // The position of each stripe is known up front, as every payload byte takes a fixed number of channels.
+            ice::postcard::u32 checksum = 0;
+            detail::write_image_data_checked(
+                job.image,
+                job.first_channel + begin * detail::channels_per_byte(job.bits),
+                { reinterpret_cast<ice::postcard::u8 const*>(job.payload.location) + begin, size },
+                job.bits,
+                checksum
+            );
+            job.stripe_checksums[stripe_index] = checksum;
+        }
+
+        //! \brief Appends the checksums of all stripes to 'checksum', in order.
+        static auto combine_stripe_checksums(
+            ice::postcard::u32 checksum,
+            ice::postcard::u32 const* stripe_checksums,
+            ice::postcard::u32 stripe_count,
+            ice::postcard::usize stripe_size,
+            ice::postcard::usize payload_size
+        ) noexcept -> ice::postcard::u32
+        {
+            for (ice::postcard::u32 idx = 0; idx < stripe_count; idx += 1)
+            {
+                ice::postcard::usize const size = std::min(stripe_size, payload_size - idx * stripe_size);
+                checksum = detail::crc::crc32c_combine(checksum, stripe_checksums[idx], size);
+            }
+            return checksum;
+        }
+
+        static void read_stripe(void* userdata, ice::postcard::u32 stripe_index) noexcept
+        {
+            StripedRead const& job = *reinterpret_cast<StripedRead const*>(userdata);
+            detail::stats::Attach const stats_attach{ job.stats };
+            ice::postcard::usize const begin = stripe_index * job.stripe_size;
+            ice::postcard::usize const size = std::min(job.stripe_size, job.payload.size - begin);
+
+            ice::postcard::u32 checksum = 0;
+            detail::read_image_data_checked(
+                job.image,
+                job.first_channel + begin * detail::channels_per_byte(job.bits),
+                { reinterpret_cast<ice::postcard::u8*>(job.payload.location) + begin, size },
+                job.bits,
+                checksum
+            );
+            job.stripe_checksums[stripe_index] = checksum;
+        }
+
+        //! \brief Compares 'checksum' of the extracted bytes with the stored one, decompressing 'stored' into 'result' if needed.
+        static auto finish_payload(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression,
+            ice::postcard::u32 checksum,
+            ice::postcard::Memory result,
+            ice::postcard::Memory stored
+        ) noexcept -> ice::postcard::Result
+        {
+            using ice::postcard::Result;
+
+            if ((header.flags & PostcardHeader::Flag_Checksum) != 0 && detail::read_checksum(image, header, compression) != checksum)
+            {
+                return Result::ErrorRead_ChecksumMismatch;
+            }
+            if (compression.compressed_size > 0 && detail::lz::decompress({ stored.location, stored.size }, result) == false)
+            {
+                return Result::ErrorRead_AttachmentCorrupted;
+            }
+            return Result::Success;
+        }
+
+        //! \brief Suspends the awaiting coroutine, queuing it on 'scheduler'.
+        struct ScheduleAwaiter
+        {
+            ice::postcard::Scheduler& scheduler;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> coroutine) const noexcept { scheduler.schedule(coroutine); }
+            void await_resume() const noexcept { }
+        };
+
+        //! \brief Rounds the chunk size of asynchronous operations up, so chunks never leave a remainder for the scalar path.
+        static auto async_chunk_size(ice::postcard::usize chunk_size) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::usize const chunks = std::max<ice::postcard::usize>((chunk_size + Constant_ChecksumChunkSize - 1) / Constant_ChecksumChunkSize, 1);
+            return chunks * Constant_ChecksumChunkSize;
+        }
+
+        static bool is_cancelled(ice::postcard::CancellationToken const* cancellation) noexcept
+        {
+            return cancellation != nullptr && cancellation->cancelled();
+        }
+
+        //! \brief Extracts the embedded bytes into 'stored' and validates them, decompressing into 'result' if needed.
+        //! \details For uncompressed attachments 'stored' and 'result' are the same memory.
+        static auto read_payload(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader const& header,
+            ice::postcard::PostcardCompression const& compression,
+            ice::postcard::usize channel,
+            ice::postcard::Memory result,
+            ice::postcard::Memory stored
+        ) noexcept -> ice::postcard::Result
+        {
+            ice::postcard::u32 checksum = detail::header_checksum(header, compression);
+            detail::read_image_data_checked(image, channel, stored, detail::density_bits(header), checksum);
+            return detail::finish_payload(image, header, compression, checksum, result, stored);
+        }
+
+        //! \brief Reads the header and the shard info of a postcard written with 'write_sharded'.
+        static auto read_shard(
+            ice::postcard::Image const& image,
+            ice::postcard::PostcardHeader& out_header,
+            ice::postcard::PostcardShardInfo& out_shard
+        ) noexcept -> ice::postcard::Result
+        {
+            PostcardCompression compression{ };
+            detail::read_header(image, out_header, compression);
+
+            if (is_postcard(out_header) == false)
+            {
+                return Result::ErrorRead_AttachmentNotFound;
+            }
+            if ((out_header.flags & PostcardHeader::Flag_Shard) == 0)
+            {
+                return Result::ErrorRead_ShardMissing;
+            }
+            if (compression.compressed_size > 0 || fits_image(image, out_header, compression) == false)
+            {
+                return Result::ErrorRead_AttachmentCorrupted;
+            }
+            if (attachment_size(out_header) < sizeof(PostcardShardInfo))
+            {
+                return Result::ErrorRead_AttachmentCorrupted;
+            }
+
+            read_attachment_range(image, out_header, 0, { &out_shard, sizeof(out_shard) });
+
+            ice::postcard::u64 const size = attachment_size(out_header) - sizeof(PostcardShardInfo);
+            if (out_shard.index >= out_shard.count || out_shard.offset > out_shard.total_size || size > out_shard.total_size - out_shard.offset)
+            {
+                return Result::ErrorRead_AttachmentCorrupted;
+            }
+            return Result::Success;
+        }
+
+        struct ShardSlice
+        {
+            ice::postcard::Image* image;
+            ice::postcard::PostcardShardInfo shard;
+            ice::postcard::usize usable;
+            ice::postcard::usize size;
+        };
+
+        struct ShardedWrite
+        {
+            ice::postcard::PostcardInfo info;
+            ice::postcard::Data attachment;
+            ice::postcard::detail::ShardSlice const* slices;
+            ice::postcard::detail::stats::Counters* stats;
+        };
+
+        struct ShardRead
+        {
+            ice::postcard::Image const* image;
+            ice::postcard::PostcardHeader header;
+            ice::postcard::PostcardShardInfo shard;
+            ice::postcard::Result result;
+        };
+
+        struct ShardedRead
+        {
+            ice::postcard::Memory attachment;
+            ice::postcard::detail::ShardRead* shards;
+            ice::postcard::detail::stats::Counters* stats;
+        };
+
+        static void write_shard(void* userdata, ice::postcard::u32 shard_index) noexcept
+        {
+            ShardedWrite const& job = *reinterpret_cast<ShardedWrite const*>(userdata);
+            detail::stats::Attach const stats_attach{ job.stats };
+            ShardSlice const& slice = job.slices[shard_index];
+
+            ice::postcard::Data const parts[]{
+                { &slice.shard, sizeof(slice.shard) },
+                { reinterpret_cast<ice::postcard::u8 const*>(job.attachment.location) + slice.shard.offset, slice.size },
+            };
+
+            ice::postcard::u8 const bits = ice::postcard::u8(job.info.density);
+            ice::postcard::u32 checksum = 0;
+            ice::postcard::usize channel = detail::write_header(
+                *slice.image, job.info, sizeof(slice.shard) + slice.size, 0, checksum, PostcardHeader::Flag_Shard
+            );
+            channel = detail::write_image_data_gathered(*slice.image, channel, parts, ice::postcard::u32(std::size(parts)), bits, checksum);
+            detail::write_checksum(*slice.image, channel, bits, checksum);
+        }
+
+        static void read_shard_data(void* userdata, ice::postcard::u32 shard_index) noexcept
+        {
+            ShardedRead const& job = *reinterpret_cast<ShardedRead const*>(userdata);
+            detail::stats::Attach const stats_attach{ job.stats };
+            ShardRead& shard = job.shards[shard_index];
+
+            ice::postcard::Memory const target{
+                reinterpret_cast<ice::postcard::u8*>(job.attachment.location) + shard.shard.offset,
+                attachment_size(shard.header) - sizeof(PostcardShardInfo)
+            };
+
+            // The shard info was already read, but is extracted again as the checksum covers it.
+            ice::postcard::PostcardShardInfo stored{ };
+            ice::postcard::u8 const bits = density_bits(shard.header);
+            ice::postcard::u32 checksum = detail::header_checksum(shard.header, PostcardCompression{ });
+            ice::postcard::usize channel = detail::read_image_data_checked(
+                *shard.image, payload_channel(shard.header), { &stored, sizeof(stored) }, bits, checksum
+            );
+            detail::read_image_data_checked(*shard.image, channel, target, bits, checksum);
+            shard.result = detail::finish_payload(*shard.image, shard.header, PostcardCompression{ }, checksum, target, target);
+        }
+
+        struct BatchWrite
+        {
+            ice::postcard::PostcardWriteJob* jobs;
+            ice::postcard::u32 job_count;
+            ice::postcard::u32 group_count;
+            ice::postcard::detail::stats::Counters* stats;
+        };
+
+        //! \brief Headers read by the first pass of 'read_batch', so they are not decoded again.
+        struct BatchHeader
+        {
+            ice::postcard::PostcardHeader header;
+            ice::postcard::PostcardCompression compression;
+            ice::postcard::usize channel;
+        };
+
+        struct BatchRead
+        {
+            ice::postcard::PostcardReadJob* jobs;
+            ice::postcard::detail::BatchHeader* headers;
+            ice::postcard::u32 job_count;
+            ice::postcard::u32 group_count;
+            ice::postcard::detail::stats::Counters* stats;
+        };
+
+        static auto batch_group_count(ice::postcard::Executor& executor, ice::postcard::u32 job_count) noexcept -> ice::postcard::u32
+        {
+            return std::min(job_count, std::max(executor.concurrency(), 1u) * Constant_BatchGroupsPerThread);
+        }
+
+        //! \brief First job of 'group', the group ends where the next one starts.
+        static auto batch_group_begin(ice::postcard::u32 group, ice::postcard::u32 group_count, ice::postcard::u32 job_count) noexcept -> ice::postcard::u32
+        {
+            return ice::postcard::u32((ice::postcard::u64(job_count) * group) / group_count);
+        }
+
+        static void write_batch_group(void* userdata, ice::postcard::u32 group) noexcept
+        {
+            BatchWrite const& batch = *reinterpret_cast<BatchWrite const*>(userdata);
+            detail::stats::Attach const stats_attach{ batch.stats };
+
+            ice::postcard::u32 const end = batch_group_begin(group + 1, batch.group_count, batch.job_count);
+            for (ice::postcard::u32 idx = batch_group_begin(group, batch.group_count, batch.job_count); idx < end; idx += 1)
+            {
+                PostcardWriteJob& job = batch.jobs[idx];
+                job.result = ice::postcard::write(job.image, job.info, job.attachment_data);
+            }
+        }
+
+        //! \brief Reads the headers, so the space needed by each job is known before anything is extracted.
+        static void read_batch_headers(void* userdata, ice::postcard::u32 group) noexcept
+        {
+            BatchRead const& batch = *reinterpret_cast<BatchRead const*>(userdata);
+            detail::stats::Attach const stats_attach{ batch.stats };
+
+            ice::postcard::u32 const end = batch_group_begin(group + 1, batch.group_count, batch.job_count);
+            for (ice::postcard::u32 idx = batch_group_begin(group, batch.group_count, batch.job_count); idx < end; idx += 1)
+            {
+                PostcardReadJob& job = batch.jobs[idx];
+                PostcardHeader& header = batch.headers[idx].header;
+                PostcardCompression& compression = batch.headers[idx].compression;
+                header = PostcardHeader{ };
+                batch.headers[idx].channel = detail::read_header(job.image, header, compression);
+
+                job.info = detail::postcard_info(header, compression);
+                job.attachment_data = { };
+                job.result = Result::Success;
+                if (detail::is_postcard(header) == false)
+                {
+                    job.result = Result::ErrorRead_AttachmentNotFound;
+                }
+                else if (detail::fits_image(job.image, header, compression) == false)
+                {
+                    job.result = Result::ErrorRead_AttachmentCorrupted;
+                }
+            }
+        }
+
+        static void read_batch_group(void* userdata, ice::postcard::u32 group) noexcept
+        {
+            BatchRead const& batch = *reinterpret_cast<BatchRead const*>(userdata);
+            detail::stats::Attach const stats_attach{ batch.stats };
+
+            ice::postcard::u32 const end = batch_group_begin(group + 1, batch.group_count, batch.job_count);
+            for (ice::postcard::u32 idx = batch_group_begin(group, batch.group_count, batch.job_count); idx < end; idx += 1)
+            {
+                PostcardReadJob& job = batch.jobs[idx];
+                if (job.result != Result::Success)
+                {
+                    continue;
+                }
+
+                // Compressed data is extracted into the same slot, behind the attachment.
+                BatchHeader const& header = batch.headers[idx];
+                ice::postcard::u8* const slot = reinterpret_cast<ice::postcard::u8*>(job.attachment_data.location);
+                ice::postcard::Memory const result{ slot, job.info.attachment_size };
+                ice::postcard::Memory const stored = header.compression.compressed_size > 0
+                    ? ice::postcard::Memory{ slot + job.info.attachment_size, header.compression.compressed_size }
+                    : result;
+
+                job.result = detail::read_payload(job.image, header.header, header.compression, header.channel, result, stored);
+                job.attachment_data = job.result == Result::Success ? result : ice::postcard::Memory{ };
+            }
+        }
+
+    } // namespace detail
+
+    auto image_region(
+        ice::postcard::Image const& image,
+        ice::postcard::u32 x,
+        ice::postcard::u32 y,
+        ice::postcard::u32 width,
+        ice::postcard::u32 height,
+        ice::postcard::Image& out_region
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        if (x > image.width || width > image.width - x || y > image.height || height > image.height - y || width == 0 || height == 0)
+        {
+            return Result::ErrorImage_RegionOutOfBounds;
+        }
+
+        // The last row of the region ends with its last pixel, any padding after it might not be part of 'image.data'.
+        ice::postcard::usize const stride = detail::row_stride(image);
+        ice::postcard::usize const offset = y * stride + x * detail::pixel_size(image);
+        out_region = Image{
+            .width = width,
+            .height = height,
+            .channels = image.channels,
+            .data = {
+                reinterpret_cast<ice::postcard::u8*>(image.data.location) + offset,
+                (height - 1) * stride + width * detail::pixel_size(image)
+            },
+            .row_stride = stride,
+            .depth = image.depth,
+        };
+        return Result::Success;
+    }
+
+    auto capacity(
+        ice::postcard::Image const& image,
+        ice::postcard::Density density /*= ice::postcard::Density::Bits1*/
+    ) noexcept -> ice::postcard::usize
+    {
+        if (detail::holds_postcard(image, density) == false)
+        {
+            return 0;
+        }
+
+        // The header always takes one bit per channel, only the attachment is stored with the requested density.
+        ice::postcard::u64 const total_available_channels = detail::total_channels(image);
+        ice::postcard::usize const total_available_bytes = ((total_available_channels - Constant_HeaderChannels) * ice::postcard::usize(density)) / Constant_ChannelsUsedPerByte;
+        return total_available_bytes - sizeof(PostcardChecksum);
+    }
+
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Attachment const& attachment
+    ) noexcept -> ice::postcard::Result
+    {
+        return write(image, info, ice::postcard::Data{ attachment._data.location, attachment._data.size });
+    }
+
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Data const& attachment_data
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::Write };
+
+        assert(info.attachment_size == 0 || info.attachment_size == attachment_data.size);
+
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default();
+        ice::postcard::usize compressed_size = 0;
+        ice::postcard::Memory compressed{ };
+        if (info.compression == Compression::LZ)
+        {
+            compressed = detail::compress_attachment(attachment_data, capacity(image, info.density), allocator, compressed_size);
+        }
+
+        if (detail::fits_capacity(image, info.density, detail::embedded_size(attachment_data.size, compressed_size, info.density)) == false)
+        {
+            if (compressed.location != nullptr)
+            {
+                allocator.deallocate(compressed);
+            }
+            return Result::ErrorWrite_AttachmentTooBig;
+        }
+
+        ice::postcard::u32 checksum = 0;
+        ice::postcard::usize channel = detail::write_header(image, info, attachment_data.size, compressed_size, checksum);
+        channel = detail::write_image_data_checked(
+            image,
+            channel,
+            compressed_size > 0 ? ice::postcard::Data{ compressed.location, compressed_size } : attachment_data,
+            ice::postcard::u8(info.density),
+            checksum
+        );
+
+        // The checksum directly follows the attachment, so we continue where the last byte ended.
+        detail::write_checksum(image, channel, ice::postcard::u8(info.density), checksum);
+
+        if (compressed.location != nullptr)
+        {
+            allocator.deallocate(compressed);
+        }
+        return Result::Success;
+    }
+
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Data const* parts,
+        ice::postcard::u32 part_count
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::Write };
+
+        ice::postcard::usize attachment_size = 0;
+        for (ice::postcard::u32 idx = 0; idx < part_count; idx += 1)
+        {
+            attachment_size += parts[idx].size;
+        }
+
+        if (detail::fits_capacity(image, info.density, detail::embedded_size(attachment_size, 0, info.density)) == false)
+        {
+            return Result::ErrorWrite_AttachmentTooBig;
+        }
+
+        ice::postcard::u8 const bits = ice::postcard::u8(info.density);
+        ice::postcard::u32 checksum = 0;
+        ice::postcard::usize channel = detail::write_header(image, info, attachment_size, 0, checksum);
+        channel = detail::write_image_data_gathered(image, channel, parts, part_count, bits, checksum);
+        detail::write_checksum(image, channel, bits, checksum);
+        return Result::Success;
+    }
+
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Attachment const& attachment,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        return write(image, info, ice::postcard::Data{ attachment._data.location, attachment._data.size }, executor);
+    }
+
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Data const& attachment_data,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::Write };
+
+        assert(info.attachment_size == 0 || info.attachment_size == attachment_data.size);
+
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default();
+        ice::postcard::usize compressed_size = 0;
+        ice::postcard::Memory compressed{ };
+        if (info.compression == Compression::LZ)
+        {
+            compressed = detail::compress_attachment(attachment_data, capacity(image, info.density), allocator, compressed_size);
+        }
+
+        if (detail::fits_capacity(image, info.density, detail::embedded_size(attachment_data.size, compressed_size, info.density)) == false)
+        {
+            if (compressed.location != nullptr)
+            {
+                allocator.deallocate(compressed);
+            }
+            return Result::ErrorWrite_AttachmentTooBig;
+        }
+
+        ice::postcard::u32 checksum = 0;
+        ice::postcard::usize const first_channel = detail::write_header(image, info, attachment_data.size, compressed_size, checksum);
+
+        detail::StripedWrite job{
+            .image = image,
+            .payload = compressed_size > 0 ? ice::postcard::Data{ compressed.location, compressed_size } : attachment_data,
+            .bits = ice::postcard::u8(info.density),
+            .first_channel = first_channel,
+            .stripe_size = 0,
+            .stripe_checksums = nullptr,
+            .stats = detail::stats::current(),
+        };
+
+        ice::postcard::u32 const stripes = detail::stripe_count(executor, job.payload.size, job.stripe_size);
+        ice::postcard::Memory const stripe_checksums = detail::stats::allocate(allocator, stripes * sizeof(ice::postcard::u32));
+        if (detail::allocated(allocator, stripe_checksums, stripes * sizeof(ice::postcard::u32)) == false)
+        {
+            if (compressed.location != nullptr)
+            {
+                allocator.deallocate(compressed);
+            }
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        job.stripe_checksums = reinterpret_cast<ice::postcard::u32*>(stripe_checksums.location);
+        executor.run(stripes, detail::write_stripe, &job);
+
+        checksum = detail::combine_stripe_checksums(checksum, job.stripe_checksums, stripes, job.stripe_size, job.payload.size);
+        detail::write_checksum(
+            image, job.first_channel + job.payload.size * detail::channels_per_byte(job.bits), job.bits, checksum
+        );
+
+        allocator.deallocate(stripe_checksums);
+        if (compressed.location != nullptr)
+        {
+            allocator.deallocate(compressed);
+        }
+        return Result::Success;
+    }
+
+    void CancellationToken::cancel() noexcept
+    {
+        _cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    bool CancellationToken::cancelled() const noexcept
+    {
+        return _cancelled.load(std::memory_order_relaxed);
+    }
+
+    auto async_write(
+        ice::postcard::Image image,
+        ice::postcard::PostcardInfo info,
+        ice::postcard::Data attachment_data,
+        ice::postcard::Scheduler& scheduler,
+        ice::postcard::CancellationToken const* cancellation,
+        ice::postcard::usize chunk_size
+    ) noexcept -> ice::postcard::AsyncResult
+    {
+        using ice::postcard::Result;
+
+        assert(info.attachment_size == 0 || info.attachment_size == attachment_data.size);
+
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default();
+        ice::postcard::usize compressed_size = 0;
+        ice::postcard::Memory compressed{ };
+        if (info.compression == Compression::LZ)
+        {
+            compressed = detail::compress_attachment(attachment_data, capacity(image, info.density), allocator, compressed_size);
+        }
+
+        if (detail::fits_capacity(image, info.density, detail::embedded_size(attachment_data.size, compressed_size, info.density)) == false)
+        {
+            if (compressed.location != nullptr)
+            {
+                allocator.deallocate(compressed);
+            }
+            co_return Result::ErrorWrite_AttachmentTooBig;
+        }
+
+        ice::postcard::u8 const bits = ice::postcard::u8(info.density);
+        ice::postcard::Data const payload = compressed_size > 0 ? ice::postcard::Data{ compressed.location, compressed_size } : attachment_data;
+        ice::postcard::usize const step = detail::async_chunk_size(chunk_size);
+
+        ice::postcard::u32 checksum = 0;
+        ice::postcard::usize channel = detail::write_header(image, info, attachment_data.size, compressed_size, checksum);
+        for (ice::postcard::usize begin = 0; begin < payload.size; begin += step)
+        {
+            if (begin > 0)
+            {
+                co_await detail::ScheduleAwaiter{ scheduler };
+            }
+
+            if (detail::is_cancelled(cancellation))
+            {
+                // A partially written attachment would only be reported as corrupted, so we remove the postcard entirely.
+                PostcardHeader const erased{ .magic = 0, .flags = 0, .revision = 0, .attachment_size = 0 };
+                detail::write_image_data(image, 0, { &erased, Constant_HeaderSize }, 1);
+                if (compressed.location != nullptr)
+                {
+                    allocator.deallocate(compressed);
+                }
+                co_return Result::ErrorAsync_Cancelled;
+            }
+
+            channel = detail::write_image_data_checked(
+                image,
+                channel,
+                { reinterpret_cast<ice::postcard::u8 const*>(payload.location) + begin, std::min(step, payload.size - begin) },
+                bits,
+                checksum
+            );
+        }
+
+        detail::write_checksum(image, channel, bits, checksum);
+        if (compressed.location != nullptr)
+        {
+            allocator.deallocate(compressed);
+        }
+        co_return Result::Success;
+    }
+
+    auto async_read(
+        ice::postcard::Image image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory& out_attachment_data,
+        ice::postcard::Scheduler& scheduler,
+        ice::postcard::CancellationToken const* cancellation,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::usize chunk_size
+    ) noexcept -> ice::postcard::AsyncResult
+    {
+        using ice::postcard::Result;
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        ice::postcard::usize channel = detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            co_return Result::ErrorRead_AttachmentNotFound;
+        }
+        if (detail::fits_image(image, header, compression) == false)
+        {
+            co_return Result::ErrorRead_AttachmentCorrupted;
+        }
+
+        ice::postcard::Memory const result = allocator.allocate(detail::attachment_size(header));
+        if (detail::allocated(allocator, result, detail::attachment_size(header)) == false)
+        {
+            co_return Result::ErrorMemory_AllocationFailed;
+        }
+
+        ice::postcard::Memory const stored = compression.compressed_size > 0
+            ? allocator.allocate(compression.compressed_size)
+            : result;
+        if (detail::allocated(allocator, stored, compression.compressed_size) == false)
+        {
+            if (result.location != nullptr)
+            {
+                allocator.deallocate(result);
+            }
+            co_return Result::ErrorMemory_AllocationFailed;
+        }
+
+        ice::postcard::u8 const bits = detail::density_bits(header);
+        ice::postcard::usize const step = detail::async_chunk_size(chunk_size);
+
+        Result payload_result = Result::Success;
+        ice::postcard::u32 checksum = detail::header_checksum(header, compression);
+        for (ice::postcard::usize begin = 0; begin < stored.size; begin += step)
+        {
+            if (begin > 0)
+            {
+                co_await detail::ScheduleAwaiter{ scheduler };
+            }
+
+            if (detail::is_cancelled(cancellation))
+            {
+                payload_result = Result::ErrorAsync_Cancelled;
+                break;
+            }
+
+            channel = detail::read_image_data_checked(
+                image,
+                channel,
+                { reinterpret_cast<ice::postcard::u8*>(stored.location) + begin, std::min(step, stored.size - begin) },
+                bits,
+                checksum
+            );
+        }
+
+        if (payload_result == Result::Success)
+        {
+            payload_result = detail::finish_payload(image, header, compression, checksum, result, stored);
+        }
+        if (stored.location != result.location)
+        {
+            allocator.deallocate(stored);
+        }
+        if (payload_result != Result::Success)
+        {
+            allocator.deallocate(result);
+            co_return payload_result;
+        }
+
+        out_info = detail::postcard_info(header, compression);
+        out_attachment_data = result;
+        co_return Result::Success;
+    }
+
+    auto read_info(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+
+        out_info = detail::postcard_info(header, compression);
+        return Result::Success;
+    }
+
+    auto verify(ice::postcard::Image const& image) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::Verify };
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        ice::postcard::usize channel = detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+        if ((header.flags & PostcardHeader::Flag_Checksum) == 0)
+        {
+            return Result::ErrorRead_ChecksumMissing;
+        }
+        if (detail::fits_image(image, header, compression) == false)
+        {
+            return Result::ErrorRead_AttachmentCorrupted;
+        }
+
+        // Bytes are decoded into a single chunk on the stack, so verification does not allocate.
+        ice::postcard::u8 chunk[Constant_ChecksumChunkSize];
+        ice::postcard::u32 checksum = detail::header_checksum(header, compression);
+        ice::postcard::usize remaining = detail::stored_size(header, compression);
+        while (remaining > 0)
+        {
+            ice::postcard::usize const size = std::min(remaining, Constant_ChecksumChunkSize);
+            channel = detail::read_image_data_checked(image, channel, { chunk, size }, detail::density_bits(header), checksum);
+            remaining -= size;
+        }
+
+        if (detail::read_checksum(image, header, compression) != checksum)
+        {
+            return Result::ErrorRead_ChecksumMismatch;
+        }
+        return Result::Success;
+    }
+
+    auto read(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Attachment& out_attachment,
+        ice::postcard::Allocator& allocator /*= ice::postcard::Allocator::get_default()*/
+    ) noexcept -> ice::postcard::Result
+    {
+        ice::postcard::Memory attachment_data{ };
+        Result const result = read(image, out_info, attachment_data, allocator);
+        if (result == Result::Success)
+        {
+            // Swapping in the new data releases the previous attachment with its own allocator.
+            out_attachment = ice::postcard::Attachment{ attachment_data, allocator };
+        }
+        return result;
+    }
+
+    auto read(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory& out_attachment_data,
+        ice::postcard::Allocator& allocator /*= ice::postcard::Allocator::get_default()*/
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::Read };
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        ice::postcard::usize const channel = detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+        if (detail::fits_image(image, header, compression) == false)
+        {
+            return Result::ErrorRead_AttachmentCorrupted;
+        }
+
+        ice::postcard::Memory const result = detail::stats::allocate(allocator, detail::attachment_size(header));
+        if (detail::allocated(allocator, result, detail::attachment_size(header)) == false)
+        {
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        ice::postcard::Memory const stored = compression.compressed_size > 0
+            ? detail::stats::allocate(allocator, compression.compressed_size)
+            : result;
+        if (detail::allocated(allocator, stored, compression.compressed_size) == false)
+        {
+            if (result.location != nullptr)
+            {
+                allocator.deallocate(result);
+            }
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        Result const payload_result = detail::read_payload(image, header, compression, channel, result, stored);
+        if (stored.location != result.location)
+        {
+            allocator.deallocate(stored);
+        }
+        if (payload_result != Result::Success)
+        {
+            allocator.deallocate(result);
+            return payload_result;
+        }
+
+        out_info = detail::postcard_info(header, compression);
+        out_attachment_data = result;
+        return Result::Success;
+    }
+
+    auto read_into(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory attachment_buffer
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::ReadInto };
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        ice::postcard::usize const channel = detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+        if (detail::fits_image(image, header, compression) == false)
+        {
+            return Result::ErrorRead_AttachmentCorrupted;
+        }
+
+        out_info = detail::postcard_info(header, compression);
+        if (attachment_buffer.size < detail::attachment_size(header) + compression.compressed_size)
+        {
+            return Result::ErrorRead_BufferTooSmall;
+        }
+
+        ice::postcard::u8* const location = reinterpret_cast<ice::postcard::u8*>(attachment_buffer.location);
+        ice::postcard::Memory const result{ location, detail::attachment_size(header) };
+        ice::postcard::Memory const stored = compression.compressed_size > 0
+            ? ice::postcard::Memory{ location + detail::attachment_size(header), compression.compressed_size }
+            : result;
+
+        return detail::read_payload(image, header, compression, channel, result, stored);
+    }
+
+    auto read_range(
+        ice::postcard::Image const& image,
+        ice::postcard::usize offset,
+        ice::postcard::usize length,
+        ice::postcard::Memory out_data
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::ReadRange };
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+        if (compression.compressed_size > 0)
+        {
+            return Result::ErrorRead_AttachmentCompressed;
+        }
+        if (detail::fits_image(image, header, compression) == false)
+        {
+            return Result::ErrorRead_AttachmentCorrupted;
+        }
+        if (offset > detail::attachment_size(header) || length > detail::attachment_size(header) - offset)
+        {
+            return Result::ErrorRead_RangeOutOfBounds;
+        }
+        if (out_data.size < length)
+        {
+            return Result::ErrorRead_BufferTooSmall;
+        }
+
+        detail::read_attachment_range(image, header, offset, { out_data.location, length });
+        return Result::Success;
+    }
+
+    auto update(
+        ice::postcard::Image& image,
+        ice::postcard::usize offset,
+        ice::postcard::Data patch
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::Update };
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+        if (compression.compressed_size > 0)
+        {
+            return Result::ErrorWrite_AttachmentCompressed;
+        }
+        if (detail::fits_image(image, header, compression) == false)
+        {
+            return Result::ErrorRead_AttachmentCorrupted;
+        }
+        if (offset > detail::attachment_size(header) || patch.size > detail::attachment_size(header) - offset)
+        {
+            return Result::ErrorWrite_RangeOutOfBounds;
+        }
+
+        ice::postcard::u8 const bits = detail::density_bits(header);
+        ice::postcard::usize channel = detail::payload_channel(header) + offset * detail::channels_per_byte(bits);
+        if ((header.flags & PostcardHeader::Flag_Checksum) == 0)
+        {
+            detail::write_image_data(image, channel, patch, bits);
+            return Result::Success;
+        }
+
+        // CRC32C is linear, so the stored checksum only needs the checksum of the flipped bits xor-ed into it.
+        //   Starting from all bits set gives an empty register, so the unchanged bytes in front of the patch can be skipped.
+        ice::postcard::u8 chunk[Constant_ChecksumChunkSize];
+        ice::postcard::u8 const* const patch_bytes = reinterpret_cast<ice::postcard::u8 const*>(patch.location);
+        ice::postcard::u32 difference = ~ice::postcard::u32{ 0 };
+        for (ice::postcard::usize begin = 0; begin < patch.size; begin += Constant_ChecksumChunkSize)
+        {
+            ice::postcard::usize const size = std::min(patch.size - begin, Constant_ChecksumChunkSize);
+            detail::read_image_data(image, channel, { chunk, size }, bits);
+            for (ice::postcard::usize idx = 0; idx < size; ++idx)
+            {
+                chunk[idx] ^= patch_bytes[begin + idx];
+            }
+
+            difference = detail::crc::crc32c(difference, { chunk, size });
+            channel = detail::write_image_data(image, channel, { patch_bytes + begin, size }, bits);
+        }
+
+        // The unchanged bytes behind the patch still move the difference, which is what combining does.
+        ice::postcard::u32 const checksum = detail::crc::crc32c_combine(
+            ~difference, detail::read_checksum(image, header, compression), detail::attachment_size(header) - offset - patch.size
+        );
+        detail::write_checksum(image, detail::checksum_channel(header, compression), bits, checksum);
+        return Result::Success;
+    }
+
+    auto write_entries(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::PostcardEntry const* entries,
+        ice::postcard::u32 entry_count,
+        ice::postcard::Allocator& allocator
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::WriteEntries };
+
+        ice::postcard::usize const table_size = sizeof(PostcardTable) + entry_count * sizeof(PostcardEntryInfo);
+        ice::postcard::usize attachment_size = table_size;
+        for (ice::postcard::u32 idx = 0; idx < entry_count; idx += 1)
+        {
+            attachment_size += entries[idx].data.size;
+        }
+
+        // Entry offsets need to fit into 32 bits, same as the attachment size in the header.
+        if (attachment_size > std::numeric_limits<ice::postcard::u32>::max() || capacity(image, info.density) < attachment_size)
+        {
+            return Result::ErrorWrite_AttachmentTooBig;
+        }
+
+        ice::postcard::Memory const table_memory = detail::stats::allocate(allocator, table_size);
+        if (detail::allocated(allocator, table_memory, table_size) == false)
+        {
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        PostcardTable* const table = new (table_memory.location) PostcardTable{ .entry_count = entry_count };
+        PostcardEntryInfo* const table_entries = reinterpret_cast<PostcardEntryInfo*>(table + 1);
+
+        // Data is stored in the given order, only the table is sorted.
+        ice::postcard::u32 offset = ice::postcard::u32(table_size);
+        for (ice::postcard::u32 idx = 0; idx < entry_count; idx += 1)
+        {
+            table_entries[idx] = PostcardEntryInfo{
+                .id = entries[idx].id,
+                .flags = entries[idx].flags,
+                .offset = offset,
+                .size = ice::postcard::u32(entries[idx].data.size),
+            };
+            offset += ice::postcard::u32(entries[idx].data.size);
+        }
+
+        auto const id_less = [](PostcardEntryInfo const& left, PostcardEntryInfo const& right) noexcept
+        {
+            return left.id < right.id;
+        };
+        auto const id_equal = [](PostcardEntryInfo const& left, PostcardEntryInfo const& right) noexcept
+        {
+            return left.id == right.id;
+        };
+
+        std::sort(table_entries, table_entries + entry_count, id_less);
+        if (std::adjacent_find(table_entries, table_entries + entry_count, id_equal) != table_entries + entry_count)
+        {
+            allocator.deallocate(table_memory);
+            return Result::ErrorWrite_EntryDuplicated;
+        }
+
+        ice::postcard::u8 const bits = ice::postcard::u8(info.density);
+        ice::postcard::u32 checksum = 0;
+        ice::postcard::usize channel = detail::write_header(image, info, attachment_size, 0, checksum, PostcardHeader::Flag_Entries);
+        channel = detail::write_image_data_checked(image, channel, { table_memory.location, table_size }, bits, checksum);
+        for (ice::postcard::u32 idx = 0; idx < entry_count; idx += 1)
+        {
+            channel = detail::write_image_data_checked(image, channel, entries[idx].data, bits, checksum);
+        }
+        detail::write_checksum(image, channel, bits, checksum);
+
+        allocator.deallocate(table_memory);
+        return Result::Success;
+    }
+
+    auto read_entries(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardEntryInfo* out_entries,
+        ice::postcard::u32 entries_capacity,
+        ice::postcard::u32& out_entry_count
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::ReadEntries };
+
+        PostcardHeader header{ };
+        PostcardTable table{ };
+        Result const result = detail::read_table(image, header, table);
+        if (result != Result::Success)
+        {
+            return result;
+        }
+
+        out_entry_count = table.entry_count;
+        if (entries_capacity < table.entry_count)
+        {
+            return Result::ErrorRead_BufferTooSmall;
+        }
+
+        detail::read_attachment_range(
+            image, header, sizeof(PostcardTable), { out_entries, table.entry_count * sizeof(PostcardEntryInfo) }
+        );
+        return Result::Success;
+    }
+
+    auto read_entry(
+        ice::postcard::Image const& image,
+        ice::postcard::u32 id,
+        ice::postcard::PostcardEntryInfo& out_entry,
+        ice::postcard::Memory& out_entry_data,
+        ice::postcard::Allocator& allocator
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::ReadEntry };
+
+        PostcardHeader header{ };
+        Result const result = detail::find_entry(image, id, header, out_entry);
+        if (result != Result::Success)
+        {
+            return result;
+        }
+
+        ice::postcard::Memory const entry_data = detail::stats::allocate(allocator, out_entry.size);
+        if (detail::allocated(allocator, entry_data, out_entry.size) == false)
+        {
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        detail::read_attachment_range(image, header, out_entry.offset, { entry_data.location, out_entry.size });
+        out_entry_data = entry_data;
+        return Result::Success;
+    }
+
+    auto read_entry_into(
+        ice::postcard::Image const& image,
+        ice::postcard::u32 id,
+        ice::postcard::PostcardEntryInfo& out_entry,
+        ice::postcard::Memory entry_buffer
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::ReadEntry };
+
+        PostcardHeader header{ };
+        Result const result = detail::find_entry(image, id, header, out_entry);
+        if (result != Result::Success)
+        {
+            return result;
+        }
+        if (entry_buffer.size < out_entry.size)
+        {
+            return Result::ErrorRead_BufferTooSmall;
+        }
+
+        detail::read_attachment_range(image, header, out_entry.offset, { entry_buffer.location, out_entry.size });
+        return Result::Success;
+    }
+
+    auto read(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Attachment& out_attachment,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        ice::postcard::Memory attachment_data{ };
+        Result const result = read(image, out_info, attachment_data, allocator, executor);
+        if (result == Result::Success)
+        {
+            // Swapping in the new data releases the previous attachment with its own allocator.
+            out_attachment = ice::postcard::Attachment{ attachment_data, allocator };
+        }
+        return result;
+    }
+
+    auto read(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory& out_attachment_data,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::Read };
+
+        PostcardHeader header{ };
+        PostcardCompression compression{ };
+        detail::read_header(image, header, compression);
+
+        if (detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+        if (detail::fits_image(image, header, compression) == false)
+        {
+            return Result::ErrorRead_AttachmentCorrupted;
+        }
+
+        ice::postcard::Memory result = detail::stats::allocate(allocator, detail::attachment_size(header));
+        if (detail::allocated(allocator, result, detail::attachment_size(header)) == false)
+        {
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        bool const compressed = compression.compressed_size > 0;
+
+        detail::StripedRead job{
+            .image = image,
+            .payload = compressed ? detail::stats::allocate(allocator, compression.compressed_size) : result,
+            .bits = detail::density_bits(header),
+            .first_channel = detail::payload_channel(header),
+            .stripe_size = 0,
+            .stripe_checksums = nullptr,
+            .stats = detail::stats::current(),
+        };
+        if (detail::allocated(allocator, job.payload, compression.compressed_size) == false)
+        {
+            if (result.location != nullptr)
+            {
+                allocator.deallocate(result);
+            }
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        ice::postcard::u32 const stripes = detail::stripe_count(executor, job.payload.size, job.stripe_size);
+        ice::postcard::Memory const stripe_checksums = detail::stats::allocate(allocator, stripes * sizeof(ice::postcard::u32));
+        if (detail::allocated(allocator, stripe_checksums, stripes * sizeof(ice::postcard::u32)) == false)
+        {
+            if (compressed)
+            {
+                allocator.deallocate(job.payload);
+            }
+            if (result.location != nullptr)
+            {
+                allocator.deallocate(result);
+            }
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        job.stripe_checksums = reinterpret_cast<ice::postcard::u32*>(stripe_checksums.location);
+        executor.run(stripes, detail::read_stripe, &job);
+
+        ice::postcard::u32 const checksum = detail::combine_stripe_checksums(
+            detail::header_checksum(header, compression), job.stripe_checksums, stripes, job.stripe_size, job.payload.size
+        );
+        allocator.deallocate(stripe_checksums);
+
+        if ((header.flags & PostcardHeader::Flag_Checksum) != 0 && detail::read_checksum(image, header, compression) != checksum)
+        {
+            if (compressed)
+            {
+                allocator.deallocate(job.payload);
+            }
+            allocator.deallocate(result);
+            return Result::ErrorRead_ChecksumMismatch;
+        }
+
+        if (compressed)
+        {
+            bool const decompressed = detail::lz::decompress({ job.payload.location, job.payload.size }, result);
+            allocator.deallocate(job.payload);
+            if (decompressed == false)
+            {
+                allocator.deallocate(result);
+                return Result::ErrorRead_AttachmentCorrupted;
+            }
+        }
+
+        out_info = detail::postcard_info(header, compression);
+        out_attachment_data = result;
+        return Result::Success;
+    }
+
+    auto write_sharded(
+        ice::postcard::Image* images,
+        ice::postcard::u32 image_count,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Data attachment_data,
+        ice::postcard::u64 set_id,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::WriteSharded };
+
+        if (image_count == 0)
+        {
+            return Result::ErrorWrite_AttachmentTooBig;
+        }
+
+        ice::postcard::Memory const slices_memory = detail::stats::allocate(allocator, image_count * sizeof(detail::ShardSlice));
+        if (detail::allocated(allocator, slices_memory, image_count * sizeof(detail::ShardSlice)) == false)
+        {
+            return Result::ErrorMemory_AllocationFailed;
+        }
+        detail::ShardSlice* const slices = reinterpret_cast<detail::ShardSlice*>(slices_memory.location);
+
+        // Each shard starts with its info and may need the larger header, the rest of the capacity is used for data.
+        ice::postcard::u64 total_usable = 0;
+        for (ice::postcard::u32 idx = 0; idx < image_count; idx += 1)
+        {
+            ice::postcard::usize const image_capacity = capacity(images[idx], info.density);
+            ice::postcard::usize const overhead = detail::embedded_size(image_capacity, 0, info.density) - image_capacity + sizeof(PostcardShardInfo);
+
+            // Every image stores a shard, even an empty one, so each needs room for the shard info.
+            if (image_capacity < overhead)
+            {
+                allocator.deallocate(slices_memory);
+                return Result::ErrorWrite_AttachmentTooBig;
+            }
+
+            slices[idx] = detail::ShardSlice{
+                .image = images + idx,
+                .shard = { .set_id = set_id, .total_size = attachment_data.size, .offset = 0, .index = idx, .count = image_count },
+                .usable = image_capacity - overhead,
+                .size = 0,
+            };
+            total_usable += slices[idx].usable;
+        }
+
+        if (total_usable < attachment_data.size)
+        {
+            allocator.deallocate(slices_memory);
+            return Result::ErrorWrite_AttachmentTooBig;
+        }
+
+        // Rounding down the proportional shares leaves a few bytes, these go to the first shards with room left.
+        ice::postcard::usize assigned = 0;
+        for (ice::postcard::u32 idx = 0; idx < image_count; idx += 1)
+        {
+            ice::postcard::usize const share = ice::postcard::usize(double(attachment_data.size) * double(slices[idx].usable) / double(total_usable));
+            slices[idx].size = std::min(slices[idx].usable, share);
+            assigned += slices[idx].size;
+        }
+        for (ice::postcard::u32 idx = 0; idx < image_count && assigned < attachment_data.size; idx += 1)
+        {
+            ice::postcard::usize const share = std::min(attachment_data.size - assigned, slices[idx].usable - slices[idx].size);
+            slices[idx].size += share;
+            assigned += share;
+        }
+
+        ice::postcard::usize offset = 0;
+        for (ice::postcard::u32 idx = 0; idx < image_count; idx += 1)
+        {
+            slices[idx].shard.offset = offset;
+            offset += slices[idx].size;
+        }
+
+        detail::ShardedWrite job{
+            .info = info,
+            .attachment = attachment_data,
+            .slices = slices,
+            .stats = detail::stats::current(),
+        };
+        executor.run(image_count, detail::write_shard, &job);
+
+        allocator.deallocate(slices_memory);
+        return Result::Success;
+    }
+
+    auto read_shard_info(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardShardInfo& out_shard
+    ) noexcept -> ice::postcard::Result
+    {
+        PostcardHeader header{ };
+        return detail::read_shard(image, header, out_shard);
+    }
+
+    auto read_sharded(
+        ice::postcard::Image const* images,
+        ice::postcard::u32 image_count,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory& out_attachment_data,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::ReadSharded };
+
+        if (image_count == 0)
+        {
+            return Result::ErrorRead_ShardSetIncomplete;
+        }
+
+        ice::postcard::Memory const shards_memory = detail::stats::allocate(allocator, image_count * sizeof(detail::ShardRead));
+        if (detail::allocated(allocator, shards_memory, image_count * sizeof(detail::ShardRead)) == false)
+        {
+            return Result::ErrorMemory_AllocationFailed;
+        }
+        detail::ShardRead* const shards = reinterpret_cast<detail::ShardRead*>(shards_memory.location);
+
+        Result result = Result::Success;
+        for (ice::postcard::u32 idx = 0; idx < image_count && result == Result::Success; idx += 1)
+        {
+            shards[idx] = detail::ShardRead{ .image = images + idx, .header = { }, .shard = { }, .result = Result::Success };
+            result = detail::read_shard(images[idx], shards[idx].header, shards[idx].shard);
+        }
+
+        // Sorted by index, a complete set holds each index once and every shard continues where the previous one ended.
+        auto const index_less = [](detail::ShardRead const& left, detail::ShardRead const& right) noexcept
+        {
+            return left.shard.index < right.shard.index;
+        };
+
+        if (result == Result::Success)
+        {
+            std::sort(shards, shards + image_count, index_less);
+
+            ice::postcard::u64 offset = 0;
+            for (ice::postcard::u32 idx = 0; idx < image_count && result == Result::Success; idx += 1)
+            {
+                PostcardShardInfo const& shard = shards[idx].shard;
+                if (shard.set_id != shards[0].shard.set_id || shard.count != image_count || shard.index != idx)
+                {
+                    result = Result::ErrorRead_ShardSetIncomplete;
+                }
+                else if (shard.total_size != shards[0].shard.total_size || shard.offset != offset)
+                {
+                    result = Result::ErrorRead_AttachmentCorrupted;
+                }
+                offset += detail::attachment_size(shards[idx].header) - sizeof(PostcardShardInfo);
+            }
+            if (result == Result::Success && offset != shards[0].shard.total_size)
+            {
+                result = Result::ErrorRead_AttachmentCorrupted;
+            }
+        }
+
+        if (result != Result::Success)
+        {
+            allocator.deallocate(shards_memory);
+            return result;
+        }
+
+        detail::ShardedRead job{
+            .attachment = detail::stats::allocate(allocator, shards[0].shard.total_size),
+            .shards = shards,
+            .stats = detail::stats::current(),
+        };
+        if (detail::allocated(allocator, job.attachment, shards[0].shard.total_size) == false)
+        {
+            allocator.deallocate(shards_memory);
+            return Result::ErrorMemory_AllocationFailed;
+        }
+        executor.run(image_count, detail::read_shard_data, &job);
+
+        for (ice::postcard::u32 idx = 0; idx < image_count && result == Result::Success; idx += 1)
+        {
+            result = shards[idx].result;
+        }
+
+        if (result != Result::Success)
+        {
+            allocator.deallocate(job.attachment);
+            allocator.deallocate(shards_memory);
+            return result;
+        }
+
+        out_info = detail::postcard_info(shards[0].header, PostcardCompression{ });
+        out_info.attachment_size = shards[0].shard.total_size;
+        out_info.is_shard = false;
+        out_attachment_data = job.attachment;
+
+        allocator.deallocate(shards_memory);
+        return Result::Success;
+    }
+
+    auto write_batch(
+        ice::postcard::PostcardWriteJob* jobs,
+        ice::postcard::u32 job_count,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::WriteBatch };
+
+        detail::BatchWrite batch{
+            .jobs = jobs,
+            .job_count = job_count,
+            .group_count = detail::batch_group_count(executor, job_count),
+            .stats = detail::stats::current(),
+        };
+        executor.run(batch.group_count, detail::write_batch_group, &batch);
+
+        for (ice::postcard::u32 idx = 0; idx < job_count; idx += 1)
+        {
+            if (jobs[idx].result != Result::Success)
+            {
+                return jobs[idx].result;
+            }
+        }
+        return Result::Success;
+    }
+
+    auto read_batch(
+        ice::postcard::PostcardReadJob* jobs,
+        ice::postcard::u32 job_count,
+        ice::postcard::Memory& out_batch_data,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        detail::stats::Scope const stats_scope{ StatsOperation::ReadBatch };
+
+        out_batch_data = { };
+        ice::postcard::Memory const headers_memory = job_count > 0
+            ? detail::stats::allocate(allocator, job_count * sizeof(detail::BatchHeader))
+            : ice::postcard::Memory{ };
+        if (detail::allocated(allocator, headers_memory, job_count * sizeof(detail::BatchHeader)) == false)
+        {
+            for (ice::postcard::u32 idx = 0; idx < job_count; idx += 1)
+            {
+                jobs[idx].attachment_data = { };
+                jobs[idx].result = Result::ErrorMemory_AllocationFailed;
+            }
+            return Result::ErrorMemory_AllocationFailed;
+        }
+
+        detail::BatchRead batch{
+            .jobs = jobs,
+            .headers = reinterpret_cast<detail::BatchHeader*>(headers_memory.location),
+            .job_count = job_count,
+            .group_count = detail::batch_group_count(executor, job_count),
+            .stats = detail::stats::current(),
+        };
+        executor.run(batch.group_count, detail::read_batch_headers, &batch);
+
+        // A single allocation holds all attachments, each slot also has room for the compressed data.
+        ice::postcard::usize batch_size = 0;
+        for (ice::postcard::u32 idx = 0; idx < job_count; idx += 1)
+        {
+            if (jobs[idx].result == Result::Success)
+            {
+                ice::postcard::usize const slot_size = jobs[idx].info.attachment_size + jobs[idx].info.compressed_size;
+                jobs[idx].attachment_data.size = slot_size;
+                batch_size += (slot_size + Constant_BatchSlotAlignment - 1) & ~(Constant_BatchSlotAlignment - 1);
+            }
+        }
+
+        out_batch_data = batch_size > 0 ? detail::stats::allocate(allocator, batch_size) : ice::postcard::Memory{ };
+        if (detail::allocated(allocator, out_batch_data, batch_size) == false)
+        {
+            // Jobs that already failed keep their own result, all others could not be extracted.
+            for (ice::postcard::u32 idx = 0; idx < job_count; idx += 1)
+            {
+                jobs[idx].attachment_data = { };
+                if (jobs[idx].result == Result::Success)
+                {
+                    jobs[idx].result = Result::ErrorMemory_AllocationFailed;
+                }
+            }
+            out_batch_data = { };
+        }
+
+        ice::postcard::u8* slot = reinterpret_cast<ice::postcard::u8*>(out_batch_data.location);
+        for (ice::postcard::u32 idx = 0; idx < job_count; idx += 1)
+        {
+            if (jobs[idx].result == Result::Success)
+            {
+                jobs[idx].attachment_data.location = slot;
+                slot += (jobs[idx].attachment_data.size + Constant_BatchSlotAlignment - 1) & ~(Constant_BatchSlotAlignment - 1);
+            }
+        }
+
+        executor.run(batch.group_count, detail::read_batch_group, &batch);
+        allocator.deallocate(headers_memory);
+
+        for (ice::postcard::u32 idx = 0; idx < job_count; idx += 1)
+        {
+            if (jobs[idx].result != Result::Success)
+            {
+                return jobs[idx].result;
+            }
+        }
+        return Result::Success;
+    }
+
+    namespace detail
+    {
+
+        //! \brief Repeats the lowest 'width' bits of 'pattern' over a whole 64 bit word.
+        static constexpr auto repeat_bits(ice::postcard::u64 pattern, ice::postcard::usize width) noexcept -> ice::postcard::u64
+        {
+            ice::postcard::u64 result = 0;
+            for (ice::postcard::usize shift = 0; shift < 64; shift += width)
+            {
+                result |= pattern << shift;
+            }
+            return result;
+        }
+
+        //! \brief Moves 'Fields' consecutive fields of 'FieldBits' bits each into the low bits of consecutive 'LaneBits' wide lanes.
+        //! \details Works like PDEP with a constant mask. Each step splits all groups of fields in half and moves the upper
+        //!   half into a slot of its own, so 8 fields need three shift, or and mask steps. Lanes need to be at least twice
+        //!   as wide as the fields, so the copies left behind by the shift are cleared by the mask.
+        template<ice::postcard::usize Fields, ice::postcard::usize FieldBits, ice::postcard::usize LaneBits>
+        static constexpr auto spread_fields(ice::postcard::u64 value) noexcept -> ice::postcard::u64
+        {
+            if constexpr (Fields == 1)
+            {
+                return value;
+            }
+            else if constexpr (FieldBits == 1)
+            {
+                // Single bits are copied into every lane by a multiplication, each lane then keeps only its own bit
+                //   and the addition carries it into the lane MSB, which is then shifted down to the LSB.
+                constexpr ice::postcard::u64 lsb = repeat_bits(1, LaneBits);
+                constexpr ice::postcard::u64 diagonal = repeat_bits(1, LaneBits + 1) & ((ice::postcard::u64{ 1 } << (Fields * LaneBits - 1)) * 2 - 1);
+                constexpr ice::postcard::u64 carry = repeat_bits((ice::postcard::u64{ 1 } << (LaneBits - 1)) - 1, LaneBits);
+                return ((((value * lsb) & diagonal) + carry) >> (LaneBits - 1)) & lsb;
+            }
+            else
+            {
+                constexpr ice::postcard::usize half = Fields / 2;
+                constexpr ice::postcard::u64 mask = repeat_bits((ice::postcard::u64{ 1 } << (half * FieldBits)) - 1, half * LaneBits);
+                return spread_fields<half, FieldBits, LaneBits>((value | (value << (half * (LaneBits - FieldBits)))) & mask);
+            }
+        }
+
+        //! \brief Reverses 'spread_fields', bits outside of the fields need to be cleared.
+        template<ice::postcard::usize Fields, ice::postcard::usize FieldBits, ice::postcard::usize LaneBits>
+        static constexpr auto gather_fields(ice::postcard::u64 value) noexcept -> ice::postcard::u64
+        {
+            if constexpr (Fields == 1)
+            {
+                return value;
+            }
+            else if constexpr (FieldBits == 1)
+            {
+                // Moves the bit of lane 'idx' to bit 'top + idx', the other partial products end up below 'top' or past the word.
+                constexpr ice::postcard::usize top = LaneBits * (Fields - 1);
+                constexpr ice::postcard::u64 multiplier = (repeat_bits(1, LaneBits - 1) & ((ice::postcard::u64{ 1 } << (top - Fields + 2)) - 1)) << (Fields - 1);
+                return ((value * multiplier) >> top) & ((1u << Fields) - 1);
+            }
+            else
+            {
+                constexpr ice::postcard::usize half = Fields / 2;
+                value = gather_fields<half, FieldBits, LaneBits>(value);
+
+                constexpr ice::postcard::u64 mask = repeat_bits((ice::postcard::u64{ 1 } << (Fields * FieldBits)) - 1, Fields * LaneBits);
+                return (value | (value >> (half * (LaneBits - FieldBits)))) & mask;
+            }
+        }
+
+        //! \brief Layout of the 64 bit words the scalar kernels update at once, each channel is a lane of 'Depth' bytes.
+        //! \details With 4 channels a word holds whole pixels. Their color channels are spread over the first three lanes
+        //!   of each pixel, so the alpha lane stays zero and is excluded from 'lane_mask'.
+        template<ice::postcard::u8 Channels, ice::postcard::u8 Bits, ice::postcard::u8 Depth>
+        struct ScalarWord
+        {
+            static constexpr ice::postcard::usize lanes = 8 / Depth;
+            static constexpr ice::postcard::usize lane_bits = 8 * Depth;
+            static constexpr ice::postcard::usize pixels = Channels == 4 ? lanes / 4 : 0;
+            static constexpr ice::postcard::usize value_bits = (Channels == 4 ? pixels * 3 : lanes) * Bits;
+
+            // Smallest number of words holding a whole number of payload bytes.
+            static constexpr ice::postcard::usize group_words = 8 / std::gcd(value_bits, ice::postcard::usize{ 8 });
+            static constexpr ice::postcard::usize group_bytes = group_words * value_bits / 8;
+
+            static constexpr ice::postcard::u64 value_mask = (ice::postcard::u64{ 1 } << value_bits) - 1;
+            static constexpr ice::postcard::u64 lane_mask = repeat_bits((1u << Bits) - 1, lane_bits)
+                & (Channels == 4 ? repeat_bits((ice::postcard::u64{ 1 } << (3 * lane_bits)) - 1, 4 * lane_bits) : ~ice::postcard::u64{ 0 });
+
+            // Fields of the three color channels of the first pixel.
+            static constexpr ice::postcard::u64 pixel_mask = (ice::postcard::u64{ 1 } << (3 * Bits)) - 1;
+
+            static constexpr auto spread(ice::postcard::u64 value) noexcept -> ice::postcard::u64
+            {
+                // An empty field is inserted for the alpha channel of the first pixel, there are at most two per word.
+                if constexpr (pixels == 2)
+                {
+                    value = (value & pixel_mask) | ((value << Bits) & (pixel_mask << (4 * Bits)));
+                }
+                return spread_fields<lanes, Bits, lane_bits>(value);
+            }
+
+            static constexpr auto gather(ice::postcard::u64 value) noexcept -> ice::postcard::u64
+            {
+                value = gather_fields<lanes, Bits, lane_bits>(value & lane_mask);
+                if constexpr (pixels == 2)
+                {
+                    value = (value & pixel_mask) | ((value >> Bits) & (pixel_mask << (3 * Bits)));
+                }
+                return value;
+            }
+        };
+
+        static auto load_word(ice::postcard::u8 const* location) noexcept -> ice::postcard::u64
+        {
+            ice::postcard::u64 result = 0;
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                std::memcpy(&result, location, sizeof(result));
+            }
+            else
+            {
+                for (ice::postcard::usize idx = sizeof(result); idx > 0; idx -= 1)
+                {
+                    result = (result << 8) | location[idx - 1];
+                }
+            }
+            return result;
+        }
+
+        static void store_word(ice::postcard::u8* location, ice::postcard::u64 value) noexcept
+        {
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                std::memcpy(location, &value, sizeof(value));
+            }
+            else
+            {
+                for (ice::postcard::usize idx = 0; idx < sizeof(value); idx += 1)
+                {
+                    location[idx] = ice::postcard::u8(value >> (idx * 8));
+                }
+            }
+        }
+
+        static_assert(ScalarWord<3, 1, 1>::spread(0b1011'0010) == 0x01'00'01'01'00'00'01'00);
+        static_assert(ScalarWord<4, 2, 1>::spread(0b11'10'01'00'11'10) == 0x00'03'02'01'00'00'03'02);
+        static_assert(ScalarWord<4, 4, 2>::gather(0xffa7'ff0c'ff03'ff0f) == 0xc3f);
+        static_assert(ScalarWord<3, 1, 1>::gather(0xff'fe'01'03'00'fe'fd'01) == 0b1011'0011);
+
+        //! \brief Writes a single byte one channel at a time, for bytes that do not start on the first channel of a pixel.
+        template<ice::postcard::u8 Channels, ice::postcard::u8 Bits, ice::postcard::u8 Depth>
+        static void write_byte_scalar(
+            ice::postcard::u8*& destination,
+            ice::postcard::u8 byte,
+            ice::postcard::u8& out_last_written_channel
+        ) noexcept
+        {
+            constexpr ice::postcard::u8 value_mask = ice::postcard::u8((1 << Bits) - 1);
+
+            // Each channel takes the next 'bits' bits, starting with the LSB of the source byte.
+            for (ice::postcard::u8 shift = 0; shift < 8; shift += Bits)
+            {
+                // For images with 4 channels we skip alpha when embedding data.
+                if constexpr (Channels == 4)
+                {
+                    if (out_last_written_channel == 3)
+                    {
+                        destination += Depth;
+                        out_last_written_channel = 0;
+                    }
+                    out_last_written_channel += 1;
+                }
+
+                destination[0] = ice::postcard::u8((destination[0] & ~value_mask) | ((byte >> shift) & value_mask));
+                destination += Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Channels, ice::postcard::u8 Bits, ice::postcard::u8 Depth>
+        static auto read_byte_scalar(
+            ice::postcard::u8 const*& source,
+            ice::postcard::u8& out_last_read_channel
+        ) noexcept -> ice::postcard::u8
+        {
+            constexpr ice::postcard::u8 value_mask = ice::postcard::u8((1 << Bits) - 1);
+
+            // Bits are stored starting with the LSB, same as in the write loop.
+            ice::postcard::u8 result = 0;
+            for (ice::postcard::u8 shift = 0; shift < 8; shift += Bits)
+            {
+                if constexpr (Channels == 4)
+                {
+                    if (out_last_read_channel == 3)
+                    {
+                        source += Depth;
+                        out_last_read_channel = 0;
+                    }
+                    out_last_read_channel += 1;
+                }
+
+                result |= ice::postcard::u8((source[0] & value_mask) << shift);
+                source += Depth;
+            }
+            return result;
+        }
+
+        //! \brief Writes 'source' without SIMD, specialized for each channel layout so the inner loops have no branches.
+        //! \details Whole groups of bytes are spread over 64 bit words of the image, each updated with a single load and store.
+        //!   Only the bytes before the first whole pixel and after the last group are written one channel at a time.
+        template<ice::postcard::u8 Channels, ice::postcard::u8 Bits, ice::postcard::u8 Depth>
+        static auto write_postcard_data_scalar(
+            ice::postcard::Memory target,
+            ice::postcard::Data source,
+            ice::postcard::u8& out_last_written_channel
+        ) noexcept -> ice::postcard::usize
+        {
+            using Word = ScalarWord<Channels, Bits, Depth>;
+            constexpr ice::postcard::usize group_bytes = Word::group_bytes;
+            constexpr ice::postcard::usize group_size = Word::group_words * sizeof(ice::postcard::u64);
+
+            // Used to calculate final offset after all data is written.
+            ice::postcard::u8* destination = reinterpret_cast<ice::postcard::u8*>(target.location);
+            ice::postcard::u8 const* const start = destination;
+            ice::postcard::u8 const* bytes = reinterpret_cast<ice::postcard::u8 const*>(source.location);
+            ice::postcard::u8 const* const bytes_end = bytes + source.size;
+
+            if constexpr (Channels == 4)
+            {
+                while (bytes < bytes_end && out_last_written_channel != 0 && out_last_written_channel != 3)
+                {
+                    write_byte_scalar<Channels, Bits, Depth>(destination, *bytes++, out_last_written_channel);
+                }
+                if (bytes_end - bytes >= ice::postcard::isize(group_bytes) && out_last_written_channel == 3)
+                {
+                    destination += Depth;
+                    out_last_written_channel = 0;
+                }
+            }
+
+            for (; bytes_end - bytes >= ice::postcard::isize(group_bytes); bytes += group_bytes, destination += group_size)
+            {
+                ice::postcard::u32 value = 0;
+                for (ice::postcard::usize idx = 0; idx < group_bytes; idx += 1)
+                {
+                    value |= ice::postcard::u32(bytes[idx]) << (idx * 8);
+                }
+
+                for (ice::postcard::usize word = 0; word < Word::group_words; word += 1)
+                {
+                    ice::postcard::u8* const location = destination + word * sizeof(ice::postcard::u64);
+                    ice::postcard::u64 const lanes = Word::spread((value >> (word * Word::value_bits)) & Word::value_mask);
+                    store_word(location, (load_word(location) & ~Word::lane_mask) | lanes);
+                }
+            }
+
+            for (; bytes < bytes_end; bytes += 1)
+            {
+                write_byte_scalar<Channels, Bits, Depth>(destination, *bytes, out_last_written_channel);
+            }
+            return ice::postcard::usize(destination - start);
+        }
+
+        template<ice::postcard::u8 Channels, ice::postcard::u8 Bits, ice::postcard::u8 Depth>
+        static auto read_postcard_data_scalar(
+            ice::postcard::Memory target,
+            ice::postcard::Data source,
+            ice::postcard::u8& out_last_read_channel
+        ) noexcept -> ice::postcard::usize
+        {
+            using Word = ScalarWord<Channels, Bits, Depth>;
+            constexpr ice::postcard::usize group_bytes = Word::group_bytes;
+            constexpr ice::postcard::usize group_size = Word::group_words * sizeof(ice::postcard::u64);
+
+            ice::postcard::u8* bytes = reinterpret_cast<ice::postcard::u8*>(target.location);
+            ice::postcard::u8* const bytes_end = bytes + target.size;
+            ice::postcard::u8 const* source_bytes = reinterpret_cast<ice::postcard::u8 const*>(source.location);
+            ice::postcard::u8 const* const source_bytes_start = source_bytes;
+
+            if constexpr (Channels == 4)
+            {
+                while (bytes < bytes_end && out_last_read_channel != 0 && out_last_read_channel != 3)
+                {
+                    *bytes++ = read_byte_scalar<Channels, Bits, Depth>(source_bytes, out_last_read_channel);
+                }
+                if (bytes_end - bytes >= ice::postcard::isize(group_bytes) && out_last_read_channel == 3)
+                {
+                    source_bytes += Depth;
+                    out_last_read_channel = 0;
+                }
+            }
+
+            for (; bytes_end - bytes >= ice::postcard::isize(group_bytes); bytes += group_bytes, source_bytes += group_size)
+            {
+                ice::postcard::u64 value = 0;
+                for (ice::postcard::usize word = 0; word < Word::group_words; word += 1)
+                {
+                    value |= Word::gather(load_word(source_bytes + word * sizeof(ice::postcard::u64))) << (word * Word::value_bits);
+                }
+
+                for (ice::postcard::usize idx = 0; idx < group_bytes; idx += 1)
+                {
+                    bytes[idx] = ice::postcard::u8(value >> (idx * 8));
+                }
+            }
+
+            for (; bytes < bytes_end; bytes += 1)
+            {
+                *bytes = read_byte_scalar<Channels, Bits, Depth>(source_bytes, out_last_read_channel);
+            }
+            return ice::postcard::usize(source_bytes - source_bytes_start);
+        }
+
+        using ScalarWriteFn = auto (*)(ice::postcard::Memory, ice::postcard::Data, ice::postcard::u8&) noexcept -> ice::postcard::usize;
+        using ScalarReadFn = ScalarWriteFn;
+
+        // Indexed by [is_rgba][density], where density is 0, 1 and 2 for 1, 2 and 4 bits per channel.
+        template<ice::postcard::u8 Depth>
+        static constexpr ScalarWriteFn Constant_ScalarWriters[2][3]{
+            { write_postcard_data_scalar<3, 1, Depth>, write_postcard_data_scalar<3, 2, Depth>, write_postcard_data_scalar<3, 4, Depth> },
+            { write_postcard_data_scalar<4, 1, Depth>, write_postcard_data_scalar<4, 2, Depth>, write_postcard_data_scalar<4, 4, Depth> },
+        };
+
+        template<ice::postcard::u8 Depth>
+        static constexpr ScalarReadFn Constant_ScalarReaders[2][3]{
+            { read_postcard_data_scalar<3, 1, Depth>, read_postcard_data_scalar<3, 2, Depth>, read_postcard_data_scalar<3, 4, Depth> },
+            { read_postcard_data_scalar<4, 1, Depth>, read_postcard_data_scalar<4, 2, Depth>, read_postcard_data_scalar<4, 4, Depth> },
+        };
+
+        static auto scalar_density_index(ice::postcard::u8 bits) noexcept -> ice::postcard::u32
+        {
+            return bits == 4 ? 2 : bits == 2 ? 1 : 0;
+        }
+
+        //! \brief Number of bytes to be handled by the scalar path, before the channel is aligned to a pixel again.
+        static auto bytes_until_pixel_aligned(
+            ice::postcard::u8 channel_count,
+            ice::postcard::u8 bits,
+            ice::postcard::u8 last_channel
+        ) noexcept -> ice::postcard::usize
+        {
+            if (channel_count != 4 || last_channel == 0 || last_channel == 3)
+            {
+                return 0;
+            }
+
+            // With 1 or 4 bits each byte moves the channel by 8 % 3 == 2 or 2 % 3 == 2, so we are aligned after one
+            //   byte from 'G' and after two from 'B'. With 2 bits it moves by 4 % 3 == 1, which is the other way around.
+            return bits == 2 ? 3 - last_channel : last_channel;
+        }
+
+        //! \brief Number of used channels in the next 'size' image bytes, where 'last_channel' is the position in the first pixel.
+        static auto used_channels(
+            ice::postcard::u8 channel_count,
+            ice::postcard::usize size,
+            ice::postcard::u8 last_channel
+        ) noexcept -> ice::postcard::usize
+        {
+            return channel_count == 4 ? size - (size + last_channel) / 4 : size;
+        }
+
+        //! \brief Number of the next image bytes that end on a pixel boundary, so SIMD kernels don't touch bytes past 'size'.
+        static auto whole_pixels_size(
+            ice::postcard::u8 channel_count,
+            ice::postcard::usize size,
+            ice::postcard::u8 last_channel
+        ) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::usize const partial_pixel = channel_count == 4 ? (size + last_channel) % 4 : 0;
+            return partial_pixel <= size ? size - partial_pixel : 0;
+        }
+
+        //! \brief Writes 'bit_count' bits of 'value', starting at 'first_bit', into the following used channels.
+        static auto write_bits(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 value,
+            ice::postcard::u8 first_bit,
+            ice::postcard::u8 bit_count,
+            ice::postcard::u8 channel_count,
+            ice::postcard::u8& last_channel
+        ) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::u8* const start = destination;
+            for (ice::postcard::u8 bit = first_bit; bit < first_bit + bit_count; bit += 1)
+            {
+                if (channel_count == 4 && last_channel == 3)
+                {
+                    destination += 1;
+                    last_channel = 0;
+                }
+
+                destination[0] = (destination[0] & detail::simd::Constant_LSBChannelClearMask[0]) | ((value >> bit) & 0x01);
+                last_channel += channel_count == 4;
+                destination += 1;
+            }
+            return ice::postcard::usize(destination - start);
+        }
+
+        //! \brief Reads 'bit_count' bits into 'value', starting at 'first_bit', from the following used channels.
+        static auto read_bits(
+            ice::postcard::u8 const* source,
+            ice::postcard::u8& value,
+            ice::postcard::u8 first_bit,
+            ice::postcard::u8 bit_count,
+            ice::postcard::u8 channel_count,
+            ice::postcard::u8& last_channel
+        ) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::u8 const* const start = source;
+            for (ice::postcard::u8 bit = first_bit; bit < first_bit + bit_count; bit += 1)
+            {
+                if (channel_count == 4 && last_channel == 3)
+                {
+                    source += 1;
+                    last_channel = 0;
+                }
+
+                value |= (source[0] & detail::simd::Constant_LSBChannelKeepMask[0]) << bit;
+                last_channel += channel_count == 4;
+                source += 1;
+            }
+            return ice::postcard::usize(source - start);
+        }
+
+        //! \brief Writes up to 'count' bytes into the image part [destination, end), where the last byte might not fit entirely.
+        //! \details A byte partially written by a previous call is finished first, its value is kept in 'pending'.
+        //! \returns Number of bytes taken from 'source', including a byte that was only partially written.
+        static auto write_stream_bytes(
+            ice::postcard::u8*& destination,
+            ice::postcard::u8* end,
+            ice::postcard::u8 channel_count,
+            ice::postcard::u8& last_channel,
+            ice::postcard::u8& bit,
+            ice::postcard::u8& pending,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize count
+        ) noexcept -> ice::postcard::usize
+        {
+            if (bit != 0)
+            {
+                ice::postcard::u8 const bits = ice::postcard::u8(std::min<ice::postcard::usize>(
+                    8 - bit, used_channels(channel_count, end - destination, last_channel)
+                ));
+                destination += write_bits(destination, pending, bit, bits, channel_count, last_channel);
+                bit = (bit + bits) % 8;
+                if (bit != 0)
+                {
+                    return 0;
+                }
+            }
+
+            ice::postcard::usize const whole_size = whole_pixels_size(channel_count, end - destination, last_channel);
+            ice::postcard::usize taken = std::min(count, used_channels(channel_count, whole_size, last_channel) / 8);
+            destination += detail::write_postcard_data({ destination, whole_size }, { source, taken }, channel_count, 1, 1, last_channel);
+
+            // What is left are less than 8 channels, plus the channels of the last pixel cut by 'end'.
+            ice::postcard::usize channels_left = used_channels(channel_count, end - destination, last_channel);
+            while (taken < count && channels_left > 0)
+            {
+                ice::postcard::u8 const bits = ice::postcard::u8(std::min<ice::postcard::usize>(8, channels_left));
+                pending = source[taken];
+                destination += write_bits(destination, pending, 0, bits, channel_count, last_channel);
+                channels_left -= bits;
+                taken += 1;
+                bit = bits % 8;
+            }
+            return taken;
+        }
+
+        //! \brief Number of header bytes in the stream, only known to include the size extension once the flags were read.
+        static auto stream_header_size(ice::postcard::u8 const* header_bytes, ice::postcard::usize completed) noexcept -> ice::postcard::usize
+        {
+            if (completed < Constant_HeaderSize)
+            {
+                return Constant_HeaderSize;
+            }
+
+            PostcardHeader header{ };
+            std::memcpy(&header.flags, header_bytes + offsetof(PostcardHeader, flags), sizeof(header.flags));
+            return header_size(header);
+        }
+
+        //! \brief Reads up to 'count' bytes from the image part [source, end), where the last byte might not fit entirely.
+        //! \details A byte partially read by a previous call is finished first, the partial value is kept in 'pending'.
+        //! \returns Number of bytes stored in 'target'.
+        static auto read_stream_bytes(
+            ice::postcard::u8 const*& source,
+            ice::postcard::u8 const* end,
+            ice::postcard::u8 channel_count,
+            ice::postcard::u8& last_channel,
+            ice::postcard::u8& bit,
+            ice::postcard::u8& pending,
+            ice::postcard::u8* target,
+            ice::postcard::usize count
+        ) noexcept -> ice::postcard::usize
+        {
+            ice::postcard::usize completed = 0;
+            if (bit != 0 && count > 0)
+            {
+                ice::postcard::u8 const bits = ice::postcard::u8(std::min<ice::postcard::usize>(
+                    8 - bit, used_channels(channel_count, end - source, last_channel)
+                ));
+                source += read_bits(source, pending, bit, bits, channel_count, last_channel);
+                bit = (bit + bits) % 8;
+                if (bit != 0)
+                {
+                    return 0;
+                }
+
+                target[0] = pending;
+                completed = 1;
+            }
+
+            ice::postcard::usize const whole_size = whole_pixels_size(channel_count, end - source, last_channel);
+            ice::postcard::usize const whole_bytes = std::min(count - completed, used_channels(channel_count, whole_size, last_channel) / 8);
+            source += detail::read_postcard_data({ target + completed, whole_bytes }, { source, whole_size }, channel_count, 1, 1, last_channel);
+            completed += whole_bytes;
+
+            ice::postcard::usize channels_left = used_channels(channel_count, end - source, last_channel);
+            while (completed < count && channels_left > 0)
+            {
+                ice::postcard::u8 const bits = ice::postcard::u8(std::min<ice::postcard::usize>(8, channels_left));
+                pending = 0;
+                source += read_bits(source, pending, 0, bits, channel_count, last_channel);
+                channels_left -= bits;
+                bit = bits % 8;
+                if (bit != 0)
+                {
+                    break;
+                }
+                target[completed] = pending;
+                completed += 1;
+            }
+            return completed;
+        }
+
+    } // namespace detail
+
+    auto detail::write_postcard_data(
+        ice::postcard::Memory target,
+        ice::postcard::Data source,
+        ice::postcard::u8 channel_count,
+        ice::postcard::u8 channel_size,
+        ice::postcard::u8 bits,
+        ice::postcard::u8& out_last_written_channel
+    ) noexcept -> ice::postcard::usize
+    {
+        // The layout is selected once, the scalar loops below are specialized for it.
+        ScalarWriteFn const write_scalar = channel_size == 2
+            ? Constant_ScalarWriters<2>[channel_count == 4][scalar_density_index(bits)]
+            : Constant_ScalarWriters<1>[channel_count == 4][scalar_density_index(bits)];
+
+        ice::postcard::usize const payload_size = source.size;
+        ice::postcard::usize scalar_size = 0;
+        ice::postcard::usize offset = 0;
+        if constexpr (detail::simd::Constant_EnabledSIMD)
+        {
+            // Images with 4 channels might require a few bytes to be written before we can use the SIMD kernels.
+            ice::postcard::usize const head_bytes = std::min(
+                source.size, bytes_until_pixel_aligned(channel_count, bits, out_last_written_channel)
+            );
+            if (head_bytes > 0)
+            {
+                offset = write_scalar(target, { source.location, head_bytes }, out_last_written_channel);
+                source.location = reinterpret_cast<ice::postcard::u8 const*>(source.location) + head_bytes;
+                source.size -= head_bytes;
+                scalar_size = head_bytes;
+            }
+
+            // The SIMD kernels consume whole blocks only and leave the remainder in 'source' for the loop below.
+            offset += detail::simd::write_postcard_data(
+                { reinterpret_cast<ice::postcard::u8*>(target.location) + offset, target.size - offset },
+                source,
+                channel_count,
+                channel_size,
+                bits,
+                out_last_written_channel
+            );
+        }
+
+        if (source.size > 0)
+        {
+            offset += write_scalar(
+                { reinterpret_cast<ice::postcard::u8*>(target.location) + offset, target.size - offset },
+                source,
+                out_last_written_channel
+            );
+            scalar_size += source.size;
+        }
+
+        if constexpr (detail::stats::Constant_Enabled)
+        {
+            detail::stats::record_data(payload_size, scalar_size, offset, detail::simd::selected_isa());
+        }
+        return offset;
+    }
+
+    auto detail::read_postcard_data(
+        ice::postcard::Memory target,
+        ice::postcard::Data source,
+        ice::postcard::u8 channel_count,
+        ice::postcard::u8 channel_size,
+        ice::postcard::u8 bits,
+        ice::postcard::u8& out_last_read_channel
+    ) noexcept -> ice::postcard::usize
+    {
+        ScalarReadFn const read_scalar = channel_size == 2
+            ? Constant_ScalarReaders<2>[channel_count == 4][scalar_density_index(bits)]
+            : Constant_ScalarReaders<1>[channel_count == 4][scalar_density_index(bits)];
+
+        ice::postcard::usize const payload_size = target.size;
+        ice::postcard::usize scalar_size = 0;
+        ice::postcard::usize offset = 0;
+        if constexpr (detail::simd::Constant_EnabledSIMD)
+        {
+            assert(source.size >= target.size * channels_per_byte(bits));
+
+            ice::postcard::usize const head_bytes = std::min(
+                target.size, bytes_until_pixel_aligned(channel_count, bits, out_last_read_channel)
+            );
+            if (head_bytes > 0)
+            {
+                offset = read_scalar({ target.location, head_bytes }, source, out_last_read_channel);
+                target.location = reinterpret_cast<ice::postcard::u8*>(target.location) + head_bytes;
+                target.size -= head_bytes;
+                scalar_size = head_bytes;
+            }
+
+            // The SIMD kernels fill whole blocks only and leave the remainder in 'target' for the loop below.
+            offset += detail::simd::read_postcard_data(
+                target,
+                { reinterpret_cast<ice::postcard::u8 const*>(source.location) + offset, source.size - offset },
+                channel_count,
+                channel_size,
+                bits,
+                out_last_read_channel
+            );
+        }
+
+        if (target.size > 0)
+        {
+            offset += read_scalar(
+                target,
+                { reinterpret_cast<ice::postcard::u8 const*>(source.location) + offset, source.size - offset },
+                out_last_read_channel
+            );
+            scalar_size += target.size;
+        }
+
+        if constexpr (detail::stats::Constant_Enabled)
+        {
+            detail::stats::record_data(payload_size, scalar_size, offset, detail::simd::selected_isa());
+        }
+        return offset;
+    }
+
+    PostcardWriter::PostcardWriter(ice::postcard::PostcardInfo const& info, ice::postcard::u8 channels) noexcept
+        : _channels{ channels }
+        , _attachment_size{ info.attachment_size }
+    {
+        PostcardHeader const header{
+            .flags = info.attachment_size > std::numeric_limits<ice::postcard::u32>::max() ? PostcardHeader::Flag_Size64 : ice::postcard::u16(0),
+            .revision = info.revision,
+            .attachment_size = ice::postcard::u32(info.attachment_size),
+            .attachment_size_high = ice::postcard::u32(info.attachment_size >> 32),
+        };
+
+        static_assert(sizeof(header) == sizeof(_header));
+        std::memcpy(_header, &header, sizeof(header));
+        _header_size = ice::postcard::u8(detail::header_size(header));
+    }
+
+    auto PostcardWriter::write(
+        ice::postcard::Memory image_part,
+        ice::postcard::Data& attachment_data
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+
+        // Check up front how many attachment bytes this part will start, so we don't fail half way through.
+        ice::postcard::usize const stream_bits = (_header_size + _attachment_size) * 8;
+        ice::postcard::usize const stream_bit = (_taken - (_bit != 0)) * 8 + _bit;
+        ice::postcard::usize const part_bits = std::min(
+            detail::used_channels(_channels, image_part.size, _last_channel), stream_bits - stream_bit
+        );
+        ice::postcard::usize const taken_end = (stream_bit + part_bits + 7) / 8;
+        ice::postcard::usize const attachment_start = std::max<ice::postcard::usize>(_taken, _header_size);
+        if (taken_end > attachment_start && attachment_data.size < taken_end - attachment_start)
+        {
+            return Result::ErrorWrite_AttachmentIncomplete;
+        }
+
+        ice::postcard::u8* destination = reinterpret_cast<ice::postcard::u8*>(image_part.location);
+        ice::postcard::u8* const end = destination + image_part.size;
+        ice::postcard::u8 last_channel = _last_channel;
+
+        // The next part continues where this one ended, even if we did not need all of its channels.
+        _last_channel = _channels == 4 ? ice::postcard::u8((_last_channel + image_part.size) % 4) : 0;
+
+        if (_taken < _header_size)
+        {
+            _taken += detail::write_stream_bytes(
+                destination, end, _channels, last_channel, _bit, _pending, _header + _taken, _header_size - _taken
+            );
+        }
+        if (_taken >= _header_size)
+        {
+            ice::postcard::usize const taken = detail::write_stream_bytes(
+                destination,
+                end,
+                _channels,
+                last_channel,
+                _bit,
+                _pending,
+                reinterpret_cast<ice::postcard::u8 const*>(attachment_data.location),
+                std::min<ice::postcard::usize>(attachment_data.size, _attachment_size - (_taken - _header_size))
+            );
+
+            _taken += taken;
+            attachment_data.location = reinterpret_cast<ice::postcard::u8 const*>(attachment_data.location) + taken;
+            attachment_data.size -= taken;
+        }
+        return Result::Success;
+    }
+
+    bool PostcardWriter::finished() const noexcept
+    {
+        return _taken == _header_size + _attachment_size && _bit == 0;
+    }
+
+    PostcardReader::PostcardReader(ice::postcard::u8 channels) noexcept
+        : _channels{ channels }
+        , _header{ }
+    {
+    }
+
+    auto PostcardReader::read(
+        ice::postcard::Data image_part,
+        ice::postcard::Memory& attachment_data
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+
+        PostcardInfo info{ };
+        ice::postcard::usize header_size = detail::stream_header_size(_header, _completed);
+        bool const has_header = _completed >= header_size;
+        if (has_header && read_info(info) != Result::Success)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+        if (has_header && info.compression != Compression::None)
+        {
+            return Result::ErrorRead_AttachmentCompressed;
+        }
+        if (has_header && info.density != Density::Bits1)
+        {
+            return Result::ErrorRead_DensityNotSupported;
+        }
+
+        // Until the header is known, we assume the attachment takes up the rest of the image.
+        ice::postcard::usize const stream_bit = _completed * 8 + _bit;
+        ice::postcard::usize part_bits = detail::used_channels(_channels, image_part.size, _last_channel);
+        if (has_header)
+        {
+            part_bits = std::min(part_bits, (header_size + info.attachment_size) * 8 - stream_bit);
+        }
+
+        ice::postcard::usize const completed_end = (stream_bit + part_bits) / 8;
+        ice::postcard::usize const attachment_start = std::max(_completed, header_size);
+        if (completed_end > attachment_start && attachment_data.size < completed_end - attachment_start)
+        {
+            return Result::ErrorRead_BufferTooSmall;
+        }
+
+        ice::postcard::u8 const* source = reinterpret_cast<ice::postcard::u8 const*>(image_part.location);
+        ice::postcard::u8 const* const end = source + image_part.size;
+        ice::postcard::u8 last_channel = _last_channel;
+
+        // The next part continues where this one ended, even if we did not need all of its channels.
+        _last_channel = _channels == 4 ? ice::postcard::u8((_last_channel + image_part.size) % 4) : 0;
+
+        if (_completed < header_size)
+        {
+            _completed += detail::read_stream_bytes(
+                source, end, _channels, last_channel, _bit, _pending, _header + _completed, header_size - _completed
+            );
+
+            // Large attachments store the upper size bits after the header, which we only know once its flags were read.
+            header_size = detail::stream_header_size(_header, _completed);
+            if (_completed < header_size)
+            {
+                _completed += detail::read_stream_bytes(
+                    source, end, _channels, last_channel, _bit, _pending, _header + _completed, header_size - _completed
+                );
+            }
+
+            if (_completed < header_size)
+            {
+                return Result::Success;
+            }
+            if (read_info(info) != Result::Success)
+            {
+                return Result::ErrorRead_AttachmentNotFound;
+            }
+            if (info.compression != Compression::None)
+            {
+                return Result::ErrorRead_AttachmentCompressed;
+            }
+            if (info.density != Density::Bits1)
+            {
+                return Result::ErrorRead_DensityNotSupported;
+            }
+        }
+
+        ice::postcard::usize const completed = detail::read_stream_bytes(
+            source,
+            end,
+            _channels,
+            last_channel,
+            _bit,
+            _pending,
+            reinterpret_cast<ice::postcard::u8*>(attachment_data.location),
+            info.attachment_size - (_completed - header_size)
+        );
+
+        _completed += completed;
+        attachment_data.location = reinterpret_cast<ice::postcard::u8*>(attachment_data.location) + completed;
+        attachment_data.size -= completed;
+        return Result::Success;
+    }
+
+    auto PostcardReader::read_info(ice::postcard::PostcardInfo& out_info) const noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+
+        PostcardHeader header{ };
+        static_assert(sizeof(header) == sizeof(_header));
+        std::memcpy(&header, _header, sizeof(header));
+
+        if (_completed < detail::stream_header_size(_header, _completed) || detail::is_postcard(header) == false)
+        {
+            return Result::ErrorRead_AttachmentNotFound;
+        }
+
+        // The compressed size follows the header and is not read by the streaming reader.
+        out_info = detail::postcard_info(header, PostcardCompression{ });
+        return Result::Success;
+    }
+
+    bool PostcardReader::finished() const noexcept
+    {
+        PostcardInfo info{ };
+        return read_info(info) == Result::Success
+            && _completed == detail::stream_header_size(_header, _completed) + info.attachment_size;
     }
 
 } // namespace ice::postcard
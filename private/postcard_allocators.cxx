@@ -0,0 +1,351 @@
+#include <ice/postcard_allocators.hxx>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace ice::postcard
+{
+
+    namespace detail::pool
+    {
+
+        // Size classes are powers of two from 64 bytes up to 16 MiB.
+        static constexpr ice::postcard::u32 Constant_SmallestClassShift = 6;
+        static constexpr ice::postcard::u32 Constant_ClassCount = 19;
+
+        // Each thread keeps up to this many bytes per size class, but always at least one block.
+        static constexpr ice::postcard::usize Constant_ThreadCacheBytes = 1024 * 1024;
+        static constexpr ice::postcard::u32 Constant_ThreadCacheMaxBlocks = 16;
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        struct FreeList
+        {
+            FreeBlock* head = nullptr;
+            ice::postcard::u32 count = 0;
+
+            void push(void* location) noexcept
+            {
+                head = new (location) FreeBlock{ head };
+                count += 1;
+            }
+
+            auto pop() noexcept -> void*
+            {
+                FreeBlock* const result = head;
+                head = result->next;
+                count -= 1;
+                return result;
+            }
+        };
+
+        static auto class_index(ice::postcard::usize size) noexcept -> ice::postcard::u32
+        {
+            ice::postcard::u32 const shift = ice::postcard::u32(std::bit_width(size - 1));
+            return shift <= Constant_SmallestClassShift ? 0 : shift - Constant_SmallestClassShift;
+        }
+
+        static auto class_size(ice::postcard::u32 index) noexcept -> ice::postcard::usize
+        {
+            return ice::postcard::usize(1) << (index + Constant_SmallestClassShift);
+        }
+
+        static auto thread_cache_limit(ice::postcard::u32 index) noexcept -> ice::postcard::u32
+        {
+            return ice::postcard::u32(std::clamp<ice::postcard::usize>(
+                Constant_ThreadCacheBytes / class_size(index), 1, Constant_ThreadCacheMaxBlocks
+            ));
+        }
+
+    } // namespace detail::pool
+
+    // Shared by the pool and every thread cache holding its blocks, destroyed by whichever lets go of it last.
+    struct PoolAllocator::State
+    {
+        struct SharedList
+        {
+            std::mutex mutex;
+            detail::pool::FreeList list;
+        };
+
+        ice::postcard::Allocator* backing;
+        std::atomic<ice::postcard::u32> references = 1;
+        SharedList classes[detail::pool::Constant_ClassCount];
+
+        void release() noexcept
+        {
+            if (references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            {
+                return;
+            }
+
+            for (ice::postcard::u32 idx = 0; idx < detail::pool::Constant_ClassCount; idx += 1)
+            {
+                while (classes[idx].list.head != nullptr)
+                {
+                    backing->deallocate({ classes[idx].list.pop(), detail::pool::class_size(idx) });
+                }
+            }
+            delete this;
+        }
+    };
+
+    namespace detail::pool
+    {
+
+        struct ThreadCache
+        {
+            ~ThreadCache() noexcept
+            {
+                detach();
+            }
+
+            //! \brief Returns 'count' cached blocks of the given class to the shared list.
+            void flush(ice::postcard::u32 index, ice::postcard::u32 count) noexcept
+            {
+                PoolAllocator::State::SharedList& shared = owner->classes[index];
+                std::lock_guard<std::mutex> lock{ shared.mutex };
+                for (; count > 0; count -= 1)
+                {
+                    shared.list.push(classes[index].pop());
+                }
+            }
+
+            void detach() noexcept
+            {
+                if (owner != nullptr)
+                {
+                    for (ice::postcard::u32 idx = 0; idx < Constant_ClassCount; idx += 1)
+                    {
+                        flush(idx, classes[idx].count);
+                    }
+                    std::exchange(owner, nullptr)->release();
+                }
+            }
+
+            //! \brief Makes 'state' the pool cached by this thread, returning blocks of the previous one.
+            void attach(PoolAllocator::State* state) noexcept
+            {
+                if (owner != state)
+                {
+                    detach();
+                    state->references.fetch_add(1, std::memory_order_relaxed);
+                    owner = state;
+                }
+            }
+
+            PoolAllocator::State* owner = nullptr;
+            FreeList classes[Constant_ClassCount];
+        };
+
+        static thread_local ThreadCache thread_cache;
+
+    } // namespace detail::pool
+
+    PoolAllocator::PoolAllocator(ice::postcard::Allocator& backing) noexcept
+        : _backing{ &backing }
+        , _state{ new (std::nothrow) State{ .backing = &backing, .classes = { } } }
+    {
+    }
+
+    PoolAllocator::~PoolAllocator() noexcept
+    {
+        if (_state != nullptr)
+        {
+            if (detail::pool::thread_cache.owner == _state)
+            {
+                detail::pool::thread_cache.detach();
+            }
+            _state->release();
+        }
+    }
+
+    auto PoolAllocator::allocate(ice::postcard::usize size) noexcept -> ice::postcard::Memory
+    {
+        using namespace detail::pool;
+
+        if (size == 0)
+        {
+            return { };
+        }
+
+        ice::postcard::u32 const index = class_index(size);
+        if (index >= Constant_ClassCount || _state == nullptr)
+        {
+            return _backing->allocate(size);
+        }
+
+        ThreadCache& cache = thread_cache;
+        cache.attach(_state);
+
+        // Take half of the thread cache limit at once, so the shared lock is not needed for every allocation.
+        if (cache.classes[index].head == nullptr)
+        {
+            State::SharedList& shared = _state->classes[index];
+            std::lock_guard<std::mutex> lock{ shared.mutex };
+            for (ice::postcard::u32 count = (thread_cache_limit(index) + 1) / 2; count > 0 && shared.list.head != nullptr; count -= 1)
+            {
+                cache.classes[index].push(shared.list.pop());
+            }
+        }
+
+        if (cache.classes[index].head != nullptr)
+        {
+            return { cache.classes[index].pop(), size };
+        }
+
+        ice::postcard::Memory const block = _backing->allocate(class_size(index));
+        return { block.location, block.location != nullptr ? size : 0 };
+    }
+
+    void PoolAllocator::deallocate(ice::postcard::Memory memory) noexcept
+    {
+        using namespace detail::pool;
+
+        if (memory.location == nullptr)
+        {
+            return;
+        }
+
+        ice::postcard::u32 const index = class_index(memory.size);
+        if (index >= Constant_ClassCount || _state == nullptr)
+        {
+            _backing->deallocate(memory);
+            return;
+        }
+
+        ThreadCache& cache = thread_cache;
+        cache.attach(_state);
+        cache.classes[index].push(memory.location);
+
+        ice::postcard::u32 const limit = thread_cache_limit(index);
+        if (cache.classes[index].count > limit)
+        {
+            cache.flush(index, cache.classes[index].count - limit / 2);
+        }
+    }
+
+    // Placed at the start of each chunk allocated from the backing allocator.
+    struct ArenaAllocator::Chunk
+    {
+        Chunk* next;
+        ice::postcard::usize size;
+    };
+
+    namespace detail::arena
+    {
+
+        static constexpr ice::postcard::usize Constant_Alignment = alignof(std::max_align_t);
+
+        static auto align_up(ice::postcard::u8* location) noexcept -> ice::postcard::u8*
+        {
+            ice::postcard::usize const address = reinterpret_cast<ice::postcard::usize>(location);
+            return location + ((Constant_Alignment - address % Constant_Alignment) % Constant_Alignment);
+        }
+
+        static auto chunk_data(ice::postcard::ArenaAllocator::Chunk* chunk) noexcept -> ice::postcard::u8*
+        {
+            return align_up(reinterpret_cast<ice::postcard::u8*>(chunk + 1));
+        }
+
+        static auto chunk_end(ice::postcard::ArenaAllocator::Chunk* chunk) noexcept -> ice::postcard::u8*
+        {
+            return reinterpret_cast<ice::postcard::u8*>(chunk) + chunk->size;
+        }
+
+    } // namespace detail::arena
+
+    ArenaAllocator::ArenaAllocator(ice::postcard::Memory buffer) noexcept
+        : _backing{ nullptr }
+        , _chunk_size{ 0 }
+        , _buffer{ buffer }
+    {
+        reset();
+    }
+
+    ArenaAllocator::ArenaAllocator(
+        ice::postcard::Allocator& backing,
+        ice::postcard::usize chunk_size
+    ) noexcept
+        : _backing{ &backing }
+        , _chunk_size{ chunk_size }
+        , _buffer{ }
+    {
+        reset();
+    }
+
+    ArenaAllocator::~ArenaAllocator() noexcept
+    {
+        while (_chunks != nullptr)
+        {
+            Chunk* const next = _chunks->next;
+            _backing->deallocate({ _chunks, _chunks->size });
+            _chunks = next;
+        }
+    }
+
+    auto ArenaAllocator::allocate(ice::postcard::usize size) noexcept -> ice::postcard::Memory
+    {
+        using namespace detail::arena;
+
+        if (size == 0)
+        {
+            return { };
+        }
+
+        ice::postcard::u8* location = align_up(_position);
+        if (location > _end || ice::postcard::usize(_end - location) < size)
+        {
+            if (_backing == nullptr)
+            {
+                return { };
+            }
+
+            // Chunks left over from before a 'reset' are reused first, if one is too small a new one is placed before it.
+            Chunk* next = _current != nullptr ? _current->next : _chunks;
+            if (next == nullptr || ice::postcard::usize(chunk_end(next) - chunk_data(next)) < size)
+            {
+                ice::postcard::usize const chunk_size = std::max(_chunk_size, sizeof(Chunk) + Constant_Alignment + size);
+                ice::postcard::Memory const memory = _backing->allocate(chunk_size);
+                if (memory.location == nullptr)
+                {
+                    return { };
+                }
+
+                next = new (memory.location) Chunk{ .next = next, .size = chunk_size };
+                (_current != nullptr ? _current->next : _chunks) = next;
+            }
+
+            _current = next;
+            _end = chunk_end(next);
+            location = chunk_data(next);
+        }
+
+        _position = location + size;
+        return { location, size };
+    }
+
+    void ArenaAllocator::deallocate(ice::postcard::Memory memory) noexcept
+    {
+        // Only the latest allocation can be returned, which covers temporary buffers released right after use.
+        if (memory.location != nullptr && reinterpret_cast<ice::postcard::u8*>(memory.location) + memory.size == _position)
+        {
+            _position = reinterpret_cast<ice::postcard::u8*>(memory.location);
+        }
+    }
+
+    void ArenaAllocator::reset() noexcept
+    {
+        _current = nullptr;
+        _position = reinterpret_cast<ice::postcard::u8*>(_buffer.location);
+        _end = _position + _buffer.size;
+    }
+
+} // namespace ice::postcard
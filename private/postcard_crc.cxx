@@ -0,0 +1,178 @@
+#include "postcard_detail.hxx"
+#include <cstring>
+
+#if ICE_POSTCARD_SIMD_ENABLED && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ice::postcard
+{
+
+    namespace detail::crc
+    {
+
+        // Reflected Castagnoli polynomial, the same one used by the SSE4.2 'crc32' instruction.
+        static constexpr ice::postcard::u32 Constant_Polynomial = 0x82f6'3b78;
+
+        struct SlicingTable
+        {
+            ice::postcard::u32 entries[8][256];
+        };
+
+        static constexpr auto create_slicing_table() noexcept -> ice::postcard::detail::crc::SlicingTable
+        {
+            SlicingTable result{ };
+            for (ice::postcard::u32 idx = 0; idx < 256; idx += 1)
+            {
+                ice::postcard::u32 value = idx;
+                for (ice::postcard::u32 bit = 0; bit < 8; bit += 1)
+                {
+                    value = (value & 1) ? (value >> 1) ^ Constant_Polynomial : value >> 1;
+                }
+                result.entries[0][idx] = value;
+            }
+
+            // Entry [N][idx] is the remainder of byte 'idx' followed by N zero bytes.
+            for (ice::postcard::u32 idx = 0; idx < 256; idx += 1)
+            {
+                for (ice::postcard::u32 slice = 1; slice < 8; slice += 1)
+                {
+                    ice::postcard::u32 const previous = result.entries[slice - 1][idx];
+                    result.entries[slice][idx] = (previous >> 8) ^ result.entries[0][previous & 0xff];
+                }
+            }
+            return result;
+        }
+
+        static constexpr SlicingTable Constant_SlicingTable = create_slicing_table();
+
+        static auto update_slicing_by_8(
+            ice::postcard::u32 crc,
+            ice::postcard::u8 const* data,
+            ice::postcard::usize size
+        ) noexcept -> ice::postcard::u32
+        {
+            auto const& table = Constant_SlicingTable.entries;
+            for (; size >= 8; size -= 8, data += 8)
+            {
+                ice::postcard::u32 lo, hi;
+                std::memcpy(&lo, data, sizeof(lo));
+                std::memcpy(&hi, data + 4, sizeof(hi));
+                lo ^= crc;
+
+                crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^ table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24]
+                    ^ table[3][hi & 0xff] ^ table[2][(hi >> 8) & 0xff] ^ table[1][(hi >> 16) & 0xff] ^ table[0][hi >> 24];
+            }
+
+            for (; size > 0; size -= 1, data += 1)
+            {
+                crc = (crc >> 8) ^ table[0][(crc ^ data[0]) & 0xff];
+            }
+            return crc;
+        }
+
+#if ICE_POSTCARD_SIMD_ENABLED
+        static bool detect_sse42() noexcept
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 20)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2");
+#endif
+        }
+
+        ICE_POSTCARD_TARGET("sse4.2")
+        static auto update_sse42(
+            ice::postcard::u32 crc,
+            ice::postcard::u8 const* data,
+            ice::postcard::usize size
+        ) noexcept -> ice::postcard::u32
+        {
+#if defined(_M_X64) || defined(__x86_64__)
+            ice::postcard::u64 crc64 = crc;
+            for (; size >= 8; size -= 8, data += 8)
+            {
+                ice::postcard::u64 value;
+                std::memcpy(&value, data, sizeof(value));
+                crc64 = _mm_crc32_u64(crc64, value);
+            }
+            crc = ice::postcard::u32(crc64);
+#endif
+            for (; size >= 4; size -= 4, data += 4)
+            {
+                ice::postcard::u32 value;
+                std::memcpy(&value, data, sizeof(value));
+                crc = _mm_crc32_u32(crc, value);
+            }
+
+            for (; size > 0; size -= 1, data += 1)
+            {
+                crc = _mm_crc32_u8(crc, data[0]);
+            }
+            return crc;
+        }
+#endif // #if ICE_POSTCARD_SIMD_ENABLED
+
+        //! \brief Multiplies two polynomials modulo the CRC polynomial, both in the reflected bit order.
+        static auto multiply_modulo(ice::postcard::u32 left, ice::postcard::u32 right) noexcept -> ice::postcard::u32
+        {
+            ice::postcard::u32 result = 0;
+            for (ice::postcard::u32 mask = 1u << 31; mask != 0; mask >>= 1)
+            {
+                if ((left & mask) != 0)
+                {
+                    result ^= right;
+                }
+                right = (right & 1) ? (right >> 1) ^ Constant_Polynomial : right >> 1;
+            }
+            return result;
+        }
+
+        //! \brief Returns x^(8 * byte_count) modulo the CRC polynomial, which moves a CRC past that many bytes.
+        static auto shift_by_bytes(ice::postcard::usize byte_count) noexcept -> ice::postcard::u32
+        {
+            ice::postcard::u32 result = 1u << 31; // x^0
+            ice::postcard::u32 power = 1u << 23; // x^8
+            for (; byte_count > 0; byte_count >>= 1)
+            {
+                if ((byte_count & 1) != 0)
+                {
+                    result = multiply_modulo(result, power);
+                }
+                power = multiply_modulo(power, power);
+            }
+            return result;
+        }
+
+    } // namespace detail::crc
+
+    auto detail::crc::crc32c(
+        ice::postcard::u32 crc,
+        ice::postcard::Data data
+    ) noexcept -> ice::postcard::u32
+    {
+        ice::postcard::u8 const* const bytes = reinterpret_cast<ice::postcard::u8 const*>(data.location);
+
+#if ICE_POSTCARD_SIMD_ENABLED
+        static bool const has_sse42 = detect_sse42();
+        if (has_sse42)
+        {
+            return ~update_sse42(~crc, bytes, data.size);
+        }
+#endif
+        return ~update_slicing_by_8(~crc, bytes, data.size);
+    }
+
+    auto detail::crc::crc32c_combine(
+        ice::postcard::u32 crc_first,
+        ice::postcard::u32 crc_second,
+        ice::postcard::usize second_size
+    ) noexcept -> ice::postcard::u32
+    {
+        return multiply_modulo(shift_by_bytes(second_size), crc_first) ^ crc_second;
+    }
+
+} // namespace ice::postcard
@@ -0,0 +1,347 @@
+#pragma once
+#include <ice/postcard.hxx>
+#include <ice/postcard_stats.hxx>
+
+#if !defined(ICE_POSTCARD_STATS)
+#define ICE_POSTCARD_STATS 0
+#endif
+
+#if ICE_POSTCARD_STATS
+#include <atomic>
+#endif
+
+#if !defined(ICE_POSTCARD_SIMD_ENABLED)
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ICE_POSTCARD_SIMD_ENABLED 1
+#else
+#define ICE_POSTCARD_SIMD_ENABLED 0
+#endif
+#endif
+
+#if ICE_POSTCARD_SIMD_ENABLED
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define ICE_POSTCARD_TARGET(isa)
+#else
+#define ICE_POSTCARD_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace ice::postcard
+{
+
+    namespace detail
+    {
+
+        //! \brief Stores 'bits' (1, 2 or 4) bits of 'source' in the lowest bits of each used channel of 'target'.
+        //! \details Channels are 'channel_size' bytes (1 or 2) wide, only the first (least significant) byte is changed.
+        auto write_postcard_data(
+            ice::postcard::Memory target,
+            ice::postcard::Data source,
+            ice::postcard::u8 channel_count,
+            ice::postcard::u8 channel_size,
+            ice::postcard::u8 bits,
+            ice::postcard::u8& out_last_written_channel
+        ) noexcept -> ice::postcard::usize;
+
+        auto read_postcard_data(
+            ice::postcard::Memory target,
+            ice::postcard::Data source,
+            ice::postcard::u8 channel_count,
+            ice::postcard::u8 channel_size,
+            ice::postcard::u8 bits,
+            ice::postcard::u8& out_last_read_channel
+        ) noexcept -> ice::postcard::usize;
+
+        namespace lz
+        {
+
+            //! \brief Compresses 'source' into 'target'.
+            //! \returns The compressed size, or zero if the result does not fit into 'target'.
+            auto compress(
+                ice::postcard::Data source,
+                ice::postcard::Memory target
+            ) noexcept -> ice::postcard::usize;
+
+            //! \brief Decompresses 'source' into 'target', which needs to be exactly the size of the original data.
+            //! \returns False if 'source' is malformed or does not decompress to 'target.size' bytes.
+            bool decompress(
+                ice::postcard::Data source,
+                ice::postcard::Memory target
+            ) noexcept;
+
+            //! \brief Largest size 'source_size' compressed bytes can decompress to, no sequence expands a byte to more than 255.
+            constexpr auto max_decompressed_size(ice::postcard::u64 source_size) noexcept -> ice::postcard::u64
+            {
+                return source_size * 255;
+            }
+
+        } // namespace lz
+
+        namespace crc
+        {
+
+            //! \brief Continues the CRC32C 'crc' with 'data', start with zero for a new checksum.
+            //! \details Uses the SSE4.2 'crc32' instruction if available, otherwise a slicing-by-8 table.
+            auto crc32c(
+                ice::postcard::u32 crc,
+                ice::postcard::Data data
+            ) noexcept -> ice::postcard::u32;
+
+            //! \brief Returns the checksum of two consecutive blocks of data, from their separate checksums.
+            auto crc32c_combine(
+                ice::postcard::u32 crc_first,
+                ice::postcard::u32 crc_second,
+                ice::postcard::usize second_size
+            ) noexcept -> ice::postcard::u32;
+
+        } // namespace crc
+
+        namespace simd
+        {
+
+            static constexpr bool Constant_EnabledSIMD = ICE_POSTCARD_SIMD_ENABLED == 1;
+
+            //! \brief Instruction sets we have kernels for, ordered from the narrowest to the widest.
+            enum class Isa : ice::postcard::u8
+            {
+                None,
+                SSE41,
+                AVX2,
+                AVX512,
+            };
+
+            //! \brief Returns the widest instruction set supported by the host, checked once on first use.
+            //! \details The result is never wider than the limit set with 'limit_isa'.
+            auto selected_isa() noexcept -> ice::postcard::detail::simd::Isa;
+
+            //! \brief Restricts kernels to instruction sets up to 'isa', used by benchmarks to compare code paths.
+            //! \note Not thread safe, needs to be called while no postcard is read or written.
+            void limit_isa(ice::postcard::detail::simd::Isa isa) noexcept;
+
+            //! \brief Writes as many whole blocks from 'source' as the selected kernels can handle.
+            //! \details Consumed bytes are removed from 'source', any remainder is left for the scalar path.
+            //! \returns The number of image bytes written.
+            auto write_postcard_data(
+                ice::postcard::Memory target,
+                ice::postcard::Data& source,
+                ice::postcard::u8 channel_count,
+                ice::postcard::u8 channel_size,
+                ice::postcard::u8 bits,
+                ice::postcard::u8& out_last_written_channel
+            ) noexcept -> ice::postcard::usize;
+
+            //! \brief Reads as many whole blocks into 'target' as the selected kernels can handle.
+            //! \details Filled bytes are removed from 'target', any remainder is left for the scalar path.
+            //! \returns The number of image bytes read.
+            auto read_postcard_data(
+                ice::postcard::Memory& target,
+                ice::postcard::Data source,
+                ice::postcard::u8 channel_count,
+                ice::postcard::u8 channel_size,
+                ice::postcard::u8 bits,
+                ice::postcard::u8& out_last_read_channel
+            ) noexcept -> ice::postcard::usize;
+
+            static constexpr ice::postcard::u8 Constant_ComponentCopyMask[32]{
+                0x00, 0x00, 0x00, 0x00,
+                0x00, 0x00, 0x00, 0x00,
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+                0x02, 0x02, 0x02, 0x02,
+                0x02, 0x02, 0x02, 0x02,
+                0x03, 0x03, 0x03, 0x03,
+                0x03, 0x03, 0x03, 0x03,
+            };
+
+            static constexpr ice::postcard::u8 Constant_BitSelectorMask[32]{
+                0x01, 0x02, 0x04, 0x08,
+                0x10, 0x20, 0x40, 0x80,
+                0x01, 0x02, 0x04, 0x08,
+                0x10, 0x20, 0x40, 0x80,
+                0x01, 0x02, 0x04, 0x08,
+                0x10, 0x20, 0x40, 0x80,
+                0x01, 0x02, 0x04, 0x08,
+                0x10, 0x20, 0x40, 0x80,
+            };
+
+            static constexpr ice::postcard::u8 Constant_LSBChannelClearMask[32]{
+                0xfe, 0xfe, 0xfe, 0xfe,
+                0xfe, 0xfe, 0xfe, 0xfe,
+                0xfe, 0xfe, 0xfe, 0xfe,
+                0xfe, 0xfe, 0xfe, 0xfe,
+                0xfe, 0xfe, 0xfe, 0xfe,
+                0xfe, 0xfe, 0xfe, 0xfe,
+                0xfe, 0xfe, 0xfe, 0xfe,
+                0xfe, 0xfe, 0xfe, 0xfe,
+            };
+
+            static constexpr ice::postcard::u8 Constant_LSBChannelKeepMask[32]{
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+                0x01, 0x01, 0x01, 0x01,
+            };
+
+            // Masks for 4 channel images, each row represents a single pixel where the last entry is 'alpha'.
+            //   Three payload bytes (24 bits) are spread over 8 pixels (32 bytes), leaving alpha untouched.
+            static constexpr ice::postcard::u8 Constant_ComponentCopy4Mask[32]{
+                0x00, 0x00, 0x00, 0x80,
+                0x00, 0x00, 0x00, 0x80,
+                0x00, 0x00, 0x01, 0x80,
+                0x01, 0x01, 0x01, 0x80,
+                0x01, 0x01, 0x01, 0x80,
+                0x01, 0x02, 0x02, 0x80,
+                0x02, 0x02, 0x02, 0x80,
+                0x02, 0x02, 0x02, 0x80,
+            };
+
+            static constexpr ice::postcard::u8 Constant_BitSelector4Mask[32]{
+                0x01, 0x02, 0x04, 0x00,
+                0x08, 0x10, 0x20, 0x00,
+                0x40, 0x80, 0x01, 0x00,
+                0x02, 0x04, 0x08, 0x00,
+                0x10, 0x20, 0x40, 0x00,
+                0x80, 0x01, 0x02, 0x00,
+                0x04, 0x08, 0x10, 0x00,
+                0x20, 0x40, 0x80, 0x00,
+            };
+
+            static constexpr ice::postcard::u8 Constant_LSBChannelClear4Mask[32]{
+                0xfe, 0xfe, 0xfe, 0xff,
+                0xfe, 0xfe, 0xfe, 0xff,
+                0xfe, 0xfe, 0xfe, 0xff,
+                0xfe, 0xfe, 0xfe, 0xff,
+                0xfe, 0xfe, 0xfe, 0xff,
+                0xfe, 0xfe, 0xfe, 0xff,
+                0xfe, 0xfe, 0xfe, 0xff,
+                0xfe, 0xfe, 0xfe, 0xff,
+            };
+
+            // Packs the 12 color channels of 4 pixels into the lower part of a 128bit lane, alpha channels are dropped.
+            static constexpr ice::postcard::u8 Constant_ComponentRead4Mask[32]{
+                0x00, 0x01, 0x02, 0x04,
+                0x05, 0x06, 0x08, 0x09,
+                0x0a, 0x0c, 0x0d, 0x0e,
+                0x80, 0x80, 0x80, 0x80,
+                0x00, 0x01, 0x02, 0x04,
+                0x05, 0x06, 0x08, 0x09,
+                0x0a, 0x0c, 0x0d, 0x0e,
+                0x80, 0x80, 0x80, 0x80,
+            };
+
+            // Spreads 12 color channels over 4 pixels, leaving the alpha entries empty.
+            static constexpr ice::postcard::u8 Constant_ComponentSpread4Mask[16]{
+                0x00, 0x01, 0x02, 0x80,
+                0x03, 0x04, 0x05, 0x80,
+                0x06, 0x07, 0x08, 0x80,
+                0x09, 0x0a, 0x0b, 0x80,
+            };
+
+            // Selects the color channel bits out of 64bit masks covering 16 pixels.
+            static constexpr ice::postcard::u64 Constant_ColorChannelBits4 = 0x7777'7777'7777'7777;
+
+        } // namespace simd
+
+        namespace stats
+        {
+
+            static constexpr bool Constant_Enabled = ICE_POSTCARD_STATS == 1;
+
+#if ICE_POSTCARD_STATS
+            //! \brief Counters of the call in progress, shared with the executor threads helping with it.
+            struct Counters
+            {
+                std::atomic<ice::postcard::usize> image_bytes = 0;
+                std::atomic<ice::postcard::usize> payload_bytes = 0;
+                std::atomic<ice::postcard::usize> scalar_bytes = 0;
+                std::atomic<ice::postcard::u32> allocations = 0;
+                std::atomic<ice::postcard::u64> allocation_ns = 0;
+                std::atomic<ice::postcard::u8> kernel = 0;
+            };
+
+            //! \brief Collects the statistics of a public call and reports them when destroyed.
+            //! \details Only the outermost scope on a thread is active, so calls made internally are not reported twice.
+            struct Scope
+            {
+                Scope(ice::postcard::StatsOperation operation) noexcept;
+                ~Scope() noexcept;
+
+                Scope(Scope const& other) noexcept = delete;
+                auto operator=(Scope const& other) noexcept -> Scope & = delete;
+
+                ice::postcard::StatsOperation _operation;
+                ice::postcard::u64 _start_ns;
+                bool _active;
+                Counters _counters;
+            };
+
+            //! \brief Makes an executor thread add to the counters of the call that started its task.
+            struct Attach
+            {
+                Attach(Counters* counters) noexcept;
+                ~Attach() noexcept;
+
+                Attach(Attach const& other) noexcept = delete;
+                auto operator=(Attach const& other) noexcept -> Attach & = delete;
+
+                bool _attached;
+            };
+
+            //! \brief Counters of the active scope on this thread, if there is one.
+            auto current() noexcept -> ice::postcard::detail::stats::Counters*;
+
+            void record_data(
+                ice::postcard::usize payload_bytes,
+                ice::postcard::usize scalar_bytes,
+                ice::postcard::usize image_bytes,
+                ice::postcard::detail::simd::Isa kernel
+            ) noexcept;
+
+            //! \brief Allocates from 'allocator', counting the allocation and the time it took.
+            auto allocate(ice::postcard::Allocator& allocator, ice::postcard::usize size) noexcept -> ice::postcard::Memory;
+#else
+            // Without statistics everything below is empty, so the instrumented code compiles to the same as before.
+            struct Counters
+            {
+            };
+
+            struct Scope
+            {
+                Scope(ice::postcard::StatsOperation) noexcept { }
+            };
+
+            struct Attach
+            {
+                Attach(Counters*) noexcept { }
+            };
+
+            inline auto current() noexcept -> ice::postcard::detail::stats::Counters*
+            {
+                return nullptr;
+            }
+
+            inline void record_data(
+                ice::postcard::usize,
+                ice::postcard::usize,
+                ice::postcard::usize,
+                ice::postcard::detail::simd::Isa
+            ) noexcept
+            {
+            }
+
+            inline auto allocate(ice::postcard::Allocator& allocator, ice::postcard::usize size) noexcept -> ice::postcard::Memory
+            {
+                return allocator.allocate(size);
+            }
+#endif
+
+        } // namespace stats
+
+    } // namespace detail
+
+} // namespace ice::postcard
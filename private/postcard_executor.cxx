@@ -0,0 +1,142 @@
+#include <ice/postcard.hxx>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace ice::postcard
+{
+
+    class ThreadPoolExecutor : public ice::postcard::Executor
+    {
+    public:
+        ThreadPoolExecutor(ice::postcard::u32 worker_count) noexcept
+        {
+            _workers.reserve(worker_count);
+            for (ice::postcard::u32 idx = 0; idx < worker_count; idx += 1)
+            {
+                // If we fail to spawn a thread we continue with the workers we already have.
+                try
+                {
+                    _workers.emplace_back([this]() noexcept { worker_loop(); });
+                }
+                catch (std::system_error const&)
+                {
+                    break;
+                }
+            }
+        }
+
+        ~ThreadPoolExecutor() noexcept
+        {
+            {
+                std::lock_guard<std::mutex> lock{ _mutex };
+                _stop = true;
+            }
+            _cv_work.notify_all();
+            for (std::thread& worker : _workers)
+            {
+                worker.join();
+            }
+        }
+
+        auto concurrency() const noexcept -> ice::postcard::u32 override
+        {
+            // The calling thread also takes part in executing tasks.
+            return ice::postcard::u32(_workers.size()) + 1;
+        }
+
+        void run(ice::postcard::u32 task_count, TaskFn* task, void* userdata) noexcept override
+        {
+            Job job{ .task = task, .userdata = userdata, .task_count = task_count };
+            if (task_count > 1 && _workers.empty() == false)
+            {
+                {
+                    std::lock_guard<std::mutex> lock{ _mutex };
+                    _jobs.push_back(&job);
+                }
+                _cv_work.notify_all();
+            }
+
+            execute(job);
+
+            // All tasks are claimed at this point, but workers might still be finishing theirs.
+            std::unique_lock<std::mutex> lock{ _mutex };
+            remove_job(&job);
+            _cv_done.wait(lock, [&job]() noexcept { return job.active_workers == 0; });
+        }
+
+    private:
+        struct Job
+        {
+            TaskFn* task;
+            void* userdata;
+            ice::postcard::u32 task_count;
+            std::atomic<ice::postcard::u32> next_task = 0;
+            ice::postcard::u32 active_workers = 0; // Protected by '_mutex'
+        };
+
+        static void execute(Job& job) noexcept
+        {
+            ice::postcard::u32 task_index = job.next_task.fetch_add(1, std::memory_order_relaxed);
+            while (task_index < job.task_count)
+            {
+                job.task(job.userdata, task_index);
+                task_index = job.next_task.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void remove_job(Job* job) noexcept
+        {
+            auto const it = std::find(_jobs.begin(), _jobs.end(), job);
+            if (it != _jobs.end())
+            {
+                _jobs.erase(it);
+            }
+        }
+
+        void worker_loop() noexcept
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            while (true)
+            {
+                _cv_work.wait(lock, [this]() noexcept { return _stop || _jobs.empty() == false; });
+                if (_stop)
+                {
+                    return;
+                }
+
+                Job* const job = _jobs.front();
+                job->active_workers += 1;
+
+                lock.unlock();
+                execute(*job);
+                lock.lock();
+
+                // No more tasks to be claimed, so no other worker should pick up this job.
+                remove_job(job);
+                job->active_workers -= 1;
+                _cv_done.notify_all();
+            }
+        }
+
+        std::mutex _mutex;
+        std::condition_variable _cv_work;
+        std::condition_variable _cv_done;
+        std::vector<Job*> _jobs;
+        std::vector<std::thread> _workers;
+        bool _stop = false;
+    };
+
+    auto ice::postcard::Executor::get_default() noexcept -> ice::postcard::Executor&
+    {
+        static ice::postcard::ThreadPoolExecutor thread_pool_global{
+            std::max(std::thread::hardware_concurrency(), 1u) - 1
+        };
+        return thread_pool_global;
+    }
+
+} // namespace ice::postcard
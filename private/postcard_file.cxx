@@ -0,0 +1,344 @@
+#include <ice/postcard_file.hxx>
+#include <cstring>
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ice::postcard
+{
+
+    namespace detail::file
+    {
+
+        struct Layout
+        {
+            ice::postcard::FileFormat format;
+            ice::postcard::u32 width;
+            ice::postcard::u32 height;
+            ice::postcard::u8 channels;
+            bool bottom_up;
+            bool bgr;
+            ice::postcard::usize row_stride;
+            ice::postcard::usize pixel_offset;
+            ice::postcard::usize pixel_size;
+        };
+
+        static auto load_u16(ice::postcard::u8 const* location) noexcept -> ice::postcard::u16
+        {
+            return ice::postcard::u16(location[0] | (location[1] << 8));
+        }
+
+        static auto load_u32(ice::postcard::u8 const* location) noexcept -> ice::postcard::u32
+        {
+            return ice::postcard::u32(location[0])
+                | (ice::postcard::u32(location[1]) << 8)
+                | (ice::postcard::u32(location[2]) << 16)
+                | (ice::postcard::u32(location[3]) << 24);
+        }
+
+        static bool parse_bmp(ice::postcard::u8 const* data, ice::postcard::usize size, Layout& out_layout) noexcept
+        {
+            // File header (14 bytes) followed by at least a BITMAPINFOHEADER (40 bytes).
+            if (size < 54 || data[0] != 'B' || data[1] != 'M' || load_u32(data + 14) < 40)
+            {
+                return false;
+            }
+
+            ice::postcard::i64 const width = ice::postcard::i64(ice::postcard::i32(load_u32(data + 18)));
+            ice::postcard::i64 const height = ice::postcard::i64(ice::postcard::i32(load_u32(data + 22)));
+            ice::postcard::u16 const bits_per_pixel = load_u16(data + 28);
+            ice::postcard::u32 const compression = load_u32(data + 30);
+            if (width <= 0 || height == 0 || compression != 0 || (bits_per_pixel != 24 && bits_per_pixel != 32))
+            {
+                return false;
+            }
+
+            // Rows are padded to a multiple of 4 bytes, the padding is skipped using the row stride.
+            ice::postcard::usize const row_size = ((ice::postcard::usize(width) * bits_per_pixel + 31) / 32) * 4;
+            ice::postcard::u32 const row_count = ice::postcard::u32(height < 0 ? -height : height);
+            out_layout = Layout{
+                .format = FileFormat::BMP,
+                .width = ice::postcard::u32(width),
+                .height = row_count,
+                .channels = ice::postcard::u8(bits_per_pixel / 8),
+                .bottom_up = height > 0, // Negative height marks a top-down bitmap.
+                .bgr = true,
+                .row_stride = row_size,
+                .pixel_offset = load_u32(data + 10),
+                .pixel_size = row_size * row_count,
+            };
+            return true;
+        }
+
+        static bool parse_ppm(ice::postcard::u8 const* data, ice::postcard::usize size, Layout& out_layout) noexcept
+        {
+            if (size < 2 || data[0] != 'P' || data[1] != '6')
+            {
+                return false;
+            }
+
+            // Width, height and the max value are separated by whitespace, where comments run until the end of a line.
+            ice::postcard::usize position = 2;
+            ice::postcard::u32 values[3]{ };
+            for (ice::postcard::u32& value : values)
+            {
+                while (position < size && (data[position] == '#' || std::strchr(" \t\r\n", data[position]) != nullptr))
+                {
+                    if (data[position] == '#')
+                    {
+                        while (position < size && data[position] != '\n')
+                        {
+                            position += 1;
+                        }
+                    }
+                    else
+                    {
+                        position += 1;
+                    }
+                }
+
+                ice::postcard::usize const digits_start = position;
+                for (; position < size && data[position] >= '0' && data[position] <= '9' && position - digits_start < 9; position += 1)
+                {
+                    value = value * 10 + (data[position] - '0');
+                }
+                if (position == digits_start || value == 0)
+                {
+                    return false;
+                }
+            }
+
+            // A single whitespace character separates the header from the pixel data.
+            if (values[2] > 255 || position >= size || std::strchr(" \t\r\n", data[position]) == nullptr)
+            {
+                return false;
+            }
+
+            out_layout = Layout{
+                .format = FileFormat::PPM,
+                .width = values[0],
+                .height = values[1],
+                .channels = 3,
+                .bottom_up = false,
+                .bgr = false,
+                .row_stride = 0,
+                .pixel_offset = position + 1,
+                .pixel_size = ice::postcard::usize(values[0]) * values[1] * 3,
+            };
+            return true;
+        }
+
+        static bool parse_tga(ice::postcard::u8 const* data, ice::postcard::usize size, Layout& out_layout) noexcept
+        {
+            // TGA has no signature, so we only accept uncompressed true-color images without a color map.
+            static constexpr ice::postcard::u8 Constant_TrueColorImage = 2;
+            static constexpr ice::postcard::u8 Constant_DescriptorTopToBottom = 0x20;
+            static constexpr ice::postcard::u8 Constant_DescriptorRightToLeft = 0x10;
+            if (size < 18 || data[1] != 0 || data[2] != Constant_TrueColorImage)
+            {
+                return false;
+            }
+
+            ice::postcard::u8 const bits_per_pixel = data[16];
+            ice::postcard::u8 const descriptor = data[17];
+            if ((bits_per_pixel != 24 && bits_per_pixel != 32) || (descriptor & Constant_DescriptorRightToLeft) != 0)
+            {
+                return false;
+            }
+
+            ice::postcard::u16 const width = load_u16(data + 12);
+            ice::postcard::u16 const height = load_u16(data + 14);
+            out_layout = Layout{
+                .format = FileFormat::TGA,
+                .width = width,
+                .height = height,
+                .channels = ice::postcard::u8(bits_per_pixel / 8),
+                .bottom_up = (descriptor & Constant_DescriptorTopToBottom) == 0,
+                .bgr = true,
+                .row_stride = 0,
+                .pixel_offset = 18 + ice::postcard::usize(data[0]),
+                .pixel_size = ice::postcard::usize(width) * height * (bits_per_pixel / 8),
+            };
+            return width > 0 && height > 0;
+        }
+
+        static bool parse_layout(ice::postcard::Memory mapping, Layout& out_layout) noexcept
+        {
+            ice::postcard::u8 const* const data = reinterpret_cast<ice::postcard::u8 const*>(mapping.location);
+            bool const parsed = parse_bmp(data, mapping.size, out_layout)
+                || parse_ppm(data, mapping.size, out_layout)
+                || parse_tga(data, mapping.size, out_layout);
+
+            return parsed
+                && out_layout.pixel_offset <= mapping.size
+                && out_layout.pixel_size <= mapping.size - out_layout.pixel_offset;
+        }
+
+#if defined(_WIN32)
+        static bool map_file(char const* path, ice::postcard::FileAccess access, ice::postcard::Memory& out_mapping) noexcept
+        {
+            bool const writable = access == FileAccess::ReadWrite;
+            HANDLE const file = CreateFileA(
+                path,
+                writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                FILE_SHARE_READ,
+                nullptr,
+                OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL,
+                nullptr
+            );
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            LARGE_INTEGER size;
+            HANDLE mapping = nullptr;
+            if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+            {
+                mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_WRITECOPY, 0, 0, nullptr);
+            }
+
+            // The view keeps the file and mapping alive, so both handles can be closed right away.
+            void* view = nullptr;
+            if (mapping != nullptr)
+            {
+                view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_COPY, 0, 0, 0);
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+
+            out_mapping = { view, view != nullptr ? ice::postcard::usize(size.QuadPart) : 0 };
+            return view != nullptr;
+        }
+
+        static void unmap_file(ice::postcard::Memory mapping) noexcept
+        {
+            UnmapViewOfFile(mapping.location);
+        }
+
+        static bool flush_file(ice::postcard::Memory mapping) noexcept
+        {
+            return FlushViewOfFile(mapping.location, mapping.size) != 0;
+        }
+#else
+        static bool map_file(char const* path, ice::postcard::FileAccess access, ice::postcard::Memory& out_mapping) noexcept
+        {
+            bool const writable = access == FileAccess::ReadWrite;
+            int const file = open(path, writable ? O_RDWR : O_RDONLY);
+            if (file < 0)
+            {
+                return false;
+            }
+
+            struct stat info;
+            void* view = MAP_FAILED;
+            if (fstat(file, &info) == 0 && info.st_size > 0)
+            {
+                // Shared mappings write changes back to the file, private ones copy a page on its first change and never write it back.
+                view = mmap(nullptr, ice::postcard::usize(info.st_size), PROT_READ | PROT_WRITE, writable ? MAP_SHARED : MAP_PRIVATE, file, 0);
+            }
+            close(file);
+
+            out_mapping = { view != MAP_FAILED ? view : nullptr, view != MAP_FAILED ? ice::postcard::usize(info.st_size) : 0 };
+            return view != MAP_FAILED;
+        }
+
+        static void unmap_file(ice::postcard::Memory mapping) noexcept
+        {
+            munmap(mapping.location, mapping.size);
+        }
+
+        static bool flush_file(ice::postcard::Memory mapping) noexcept
+        {
+            return msync(mapping.location, mapping.size, MS_SYNC) == 0;
+        }
+#endif
+
+    } // namespace detail::file
+
+    ImageFile::~ImageFile() noexcept
+    {
+        if (_mapping.location != nullptr)
+        {
+            detail::file::unmap_file(_mapping);
+        }
+    }
+
+    ImageFile::ImageFile(ImageFile&& other) noexcept
+        : format{ std::exchange(other.format, FileFormat::Unknown) }
+        , bottom_up{ std::exchange(other.bottom_up, false) }
+        , bgr{ std::exchange(other.bgr, false) }
+        , image{ std::exchange(other.image, { }) }
+        , _mapping{ std::exchange(other._mapping, { }) }
+    {
+    }
+
+    auto ImageFile::operator=(ImageFile&& other) noexcept -> ImageFile&
+    {
+        if (this != &other)
+        {
+            std::swap(format, other.format);
+            std::swap(bottom_up, other.bottom_up);
+            std::swap(bgr, other.bgr);
+            std::swap(image, other.image);
+            std::swap(_mapping, other._mapping);
+        }
+        return *this;
+    }
+
+    auto open_image_file(
+        char const* path,
+        ice::postcard::FileAccess access,
+        ice::postcard::ImageFile& out_file
+    ) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+
+        ImageFile result{ };
+        if (detail::file::map_file(path, access, result._mapping) == false)
+        {
+            return Result::ErrorFile_OpenFailed;
+        }
+
+        detail::file::Layout layout{ };
+        if (detail::file::parse_layout(result._mapping, layout) == false)
+        {
+            return Result::ErrorFile_FormatNotSupported;
+        }
+
+        result.format = layout.format;
+        result.bottom_up = layout.bottom_up;
+        result.bgr = layout.bgr;
+        result.image = Image{
+            .width = layout.width,
+            .height = layout.height,
+            .channels = layout.channels,
+            .data = { reinterpret_cast<ice::postcard::u8*>(result._mapping.location) + layout.pixel_offset, layout.pixel_size },
+            .row_stride = layout.row_stride,
+        };
+
+        out_file = std::move(result);
+        return Result::Success;
+    }
+
+    auto flush_image_file(ice::postcard::ImageFile& file) noexcept -> ice::postcard::Result
+    {
+        using ice::postcard::Result;
+        if (file._mapping.location == nullptr || detail::file::flush_file(file._mapping) == false)
+        {
+            return Result::ErrorFile_WriteFailed;
+        }
+        return Result::Success;
+    }
+
+} // namespace ice::postcard
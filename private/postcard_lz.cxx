@@ -0,0 +1,243 @@
+#include "postcard_detail.hxx"
+#include <algorithm>
+#include <cstring>
+
+namespace ice::postcard
+{
+
+    // The block format follows LZ4: each sequence starts with a token holding the literal length in the high nibble
+    //   and the match length (minus Constant_MinMatch) in the low nibble, both extended with 255 valued bytes if they
+    //   are equal to 15. Literals are followed by a 16bit little endian offset. The last sequence has only literals.
+    namespace detail::lz
+    {
+
+        static constexpr ice::postcard::usize Constant_MinMatch = 4;
+        static constexpr ice::postcard::usize Constant_MaxOffset = 0xffff;
+        static constexpr ice::postcard::u32 Constant_HashBits = 12;
+
+        static auto load_u32(ice::postcard::u8 const* location) noexcept -> ice::postcard::u32
+        {
+            ice::postcard::u32 result;
+            std::memcpy(&result, location, sizeof(result));
+            return result;
+        }
+
+        static auto hash(ice::postcard::u32 value) noexcept -> ice::postcard::u32
+        {
+            return (value * 2654435761u) >> (32 - Constant_HashBits);
+        }
+
+        static bool write_length(
+            ice::postcard::u8*& destination,
+            ice::postcard::u8 const* end,
+            ice::postcard::usize length
+        ) noexcept
+        {
+            for (; length >= 255; length -= 255)
+            {
+                if (destination == end)
+                {
+                    return false;
+                }
+                *destination++ = 255;
+            }
+
+            if (destination == end)
+            {
+                return false;
+            }
+            *destination++ = ice::postcard::u8(length);
+            return true;
+        }
+
+        static bool read_length(
+            ice::postcard::u8 const*& source,
+            ice::postcard::u8 const* end,
+            ice::postcard::usize& length
+        ) noexcept
+        {
+            ice::postcard::u8 value = 255;
+            while (value == 255)
+            {
+                if (source == end)
+                {
+                    return false;
+                }
+                value = *source++;
+                length += value;
+            }
+            return true;
+        }
+
+        static bool write_sequence(
+            ice::postcard::u8*& destination,
+            ice::postcard::u8 const* end,
+            ice::postcard::u8 const* literals,
+            ice::postcard::usize literal_length,
+            ice::postcard::usize offset,
+            ice::postcard::usize match_length
+        ) noexcept
+        {
+            if (destination == end)
+            {
+                return false;
+            }
+
+            ice::postcard::usize const match_code = match_length > 0 ? match_length - Constant_MinMatch : 0;
+            ice::postcard::u8* const token = destination++;
+            *token = ice::postcard::u8((std::min<ice::postcard::usize>(literal_length, 15) << 4) | std::min<ice::postcard::usize>(match_code, 15));
+
+            if (literal_length >= 15 && write_length(destination, end, literal_length - 15) == false)
+            {
+                return false;
+            }
+            if (ice::postcard::usize(end - destination) < literal_length)
+            {
+                return false;
+            }
+            std::memcpy(destination, literals, literal_length);
+            destination += literal_length;
+
+            // The last sequence consists only of literals.
+            if (match_length == 0)
+            {
+                return true;
+            }
+
+            if (end - destination < 2)
+            {
+                return false;
+            }
+            *destination++ = ice::postcard::u8(offset);
+            *destination++ = ice::postcard::u8(offset >> 8);
+            return match_code < 15 || write_length(destination, end, match_code - 15);
+        }
+
+    } // namespace detail::lz
+
+    auto detail::lz::compress(
+        ice::postcard::Data source,
+        ice::postcard::Memory target
+    ) noexcept -> ice::postcard::usize
+    {
+        ice::postcard::u8 const* const source_begin = reinterpret_cast<ice::postcard::u8 const*>(source.location);
+        ice::postcard::u8 const* const source_end = source_begin + source.size;
+        ice::postcard::u8* const target_begin = reinterpret_cast<ice::postcard::u8*>(target.location);
+        ice::postcard::u8 const* const target_end = target_begin + target.size;
+
+        // Positions are stored with an offset of one, so zero marks an empty slot.
+        ice::postcard::u32 table[1 << Constant_HashBits]{ };
+
+        ice::postcard::u8* destination = target_begin;
+        ice::postcard::u8 const* anchor = source_begin;
+        ice::postcard::u8 const* current = source_begin;
+        while (source_end - current >= ice::postcard::isize(Constant_MinMatch))
+        {
+            ice::postcard::u32 const value = load_u32(current);
+            ice::postcard::u32& slot = table[hash(value)];
+            ice::postcard::u8 const* const candidate = slot != 0 ? source_begin + (slot - 1) : nullptr;
+            bool const has_candidate = candidate != nullptr && ice::postcard::usize(current - candidate) <= Constant_MaxOffset;
+            slot = ice::postcard::u32(current - source_begin) + 1;
+
+            if (has_candidate == false || load_u32(candidate) != value)
+            {
+                // Skip faster over data that does not compress well.
+                current += 1 + ((current - anchor) >> 6);
+                continue;
+            }
+
+            ice::postcard::usize match_length = Constant_MinMatch;
+            while (current + match_length < source_end && candidate[match_length] == current[match_length])
+            {
+                match_length += 1;
+            }
+
+            if (write_sequence(destination, target_end, anchor, current - anchor, current - candidate, match_length) == false)
+            {
+                return 0;
+            }
+
+            current += match_length;
+            anchor = current;
+        }
+
+        if (write_sequence(destination, target_end, anchor, source_end - anchor, 0, 0) == false)
+        {
+            return 0;
+        }
+        return ice::postcard::usize(destination - target_begin);
+    }
+
+    bool detail::lz::decompress(
+        ice::postcard::Data source,
+        ice::postcard::Memory target
+    ) noexcept
+    {
+        ice::postcard::u8 const* current = reinterpret_cast<ice::postcard::u8 const*>(source.location);
+        ice::postcard::u8 const* const source_end = current + source.size;
+        ice::postcard::u8* const target_begin = reinterpret_cast<ice::postcard::u8*>(target.location);
+        ice::postcard::u8* destination = target_begin;
+        ice::postcard::u8 const* const target_end = target_begin + target.size;
+
+        // The data comes from an image that might have been modified, so every step is bounds checked.
+        while (current < source_end)
+        {
+            ice::postcard::u8 const token = *current++;
+
+            ice::postcard::usize literal_length = token >> 4;
+            if (literal_length == 15 && read_length(current, source_end, literal_length) == false)
+            {
+                return false;
+            }
+            if (ice::postcard::usize(source_end - current) < literal_length || ice::postcard::usize(target_end - destination) < literal_length)
+            {
+                return false;
+            }
+            std::memcpy(destination, current, literal_length);
+            destination += literal_length;
+            current += literal_length;
+
+            if (current == source_end)
+            {
+                break;
+            }
+
+            if (source_end - current < 2)
+            {
+                return false;
+            }
+            ice::postcard::usize const offset = ice::postcard::usize(current[0]) | (ice::postcard::usize(current[1]) << 8);
+            current += 2;
+
+            ice::postcard::usize match_length = token & 0x0f;
+            if (match_length == 15 && read_length(current, source_end, match_length) == false)
+            {
+                return false;
+            }
+            match_length += Constant_MinMatch;
+
+            if (offset == 0 || offset > ice::postcard::usize(destination - target_begin) || ice::postcard::usize(target_end - destination) < match_length)
+            {
+                return false;
+            }
+
+            // Matches can overlap the bytes they produce, which repeats the pattern.
+            ice::postcard::u8 const* match = destination - offset;
+            if (offset >= match_length)
+            {
+                std::memcpy(destination, match, match_length);
+                destination += match_length;
+            }
+            else
+            {
+                for (ice::postcard::usize idx = 0; idx < match_length; idx += 1)
+                {
+                    *destination++ = *match++;
+                }
+            }
+        }
+
+        return destination == target_end;
+    }
+
+} // namespace ice::postcard
@@ -0,0 +1,1479 @@
+#include "postcard_detail.hxx"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if ICE_POSTCARD_SIMD_ENABLED && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ice::postcard
+{
+
+#if ICE_POSTCARD_SIMD_ENABLED
+    namespace detail::simd
+    {
+
+        static auto detect_isa() noexcept -> ice::postcard::detail::simd::Isa
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            ice::postcard::u32 const max_leaf = info[0];
+
+            __cpuid(info, 1);
+            bool const has_ssse3 = (info[2] & (1 << 9)) != 0;
+            bool const has_sse41 = (info[2] & (1 << 19)) != 0;
+            bool const has_osxsave = (info[2] & (1 << 27)) != 0;
+            if (has_ssse3 == false || has_sse41 == false)
+            {
+                return Isa::None;
+            }
+
+            ice::postcard::u64 const xcr0 = has_osxsave ? _xgetbv(0) : 0;
+            bool const os_saves_ymm = (xcr0 & 0x06) == 0x06;
+            bool const os_saves_zmm = (xcr0 & 0xe6) == 0xe6;
+            if (max_leaf < 7 || os_saves_ymm == false)
+            {
+                return Isa::SSE41;
+            }
+
+            __cpuidex(info, 7, 0);
+            bool const has_avx2 = (info[1] & (1 << 5)) != 0;
+            bool const has_avx512f = (info[1] & (1 << 16)) != 0;
+            bool const has_avx512bw = (info[1] & (1 << 30)) != 0;
+            bool const has_bmi2 = (info[1] & (1 << 8)) != 0;
+            if (has_avx512f && has_avx512bw && has_bmi2 && os_saves_zmm)
+            {
+                return Isa::AVX512;
+            }
+            return has_avx2 ? Isa::AVX2 : Isa::SSE41;
+#else
+            // The builtins already take into account if the OS preserves the extended register state.
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("bmi2"))
+            {
+                return Isa::AVX512;
+            }
+            if (__builtin_cpu_supports("avx2"))
+            {
+                return Isa::AVX2;
+            }
+            if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3"))
+            {
+                return Isa::SSE41;
+            }
+            return Isa::None;
+#endif
+        }
+
+        // All kernels access the image through the helpers below, so they can be instantiated for each channel depth.
+        //   With 16 bit channels only the low byte of each channel is loaded, which gives the kernels the same register
+        //   layout as 8 bit channels, while the high bytes are written back unchanged.
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static auto load_image_sse41(ice::postcard::u8 const* location) noexcept -> __m128i
+        {
+            if constexpr (Depth == 1)
+            {
+                return _mm_loadu_si128(reinterpret_cast<__m128i const*>(location));
+            }
+            else
+            {
+                __m128i const low_bytes = _mm_set1_epi16(0x00ff);
+                __m128i const v0 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(location)), low_bytes);
+                __m128i const v1 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(location + 16)), low_bytes);
+                return _mm_packus_epi16(v0, v1);
+            }
+        }
+
+        //! \brief Stores '(image & clear) | value' for the channels at 'location'.
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void update_image_sse41(ice::postcard::u8* location, __m128i clear, __m128i value) noexcept
+        {
+            if constexpr (Depth == 1)
+            {
+                __m128i img = _mm_loadu_si128(reinterpret_cast<__m128i const*>(location));
+                img = _mm_or_si128(_mm_and_si128(img, clear), value);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(location), img);
+            }
+            else
+            {
+                __m128i const high_bytes = _mm_set1_epi16(short(0xff00));
+                __m128i const clear0 = _mm_or_si128(_mm_cvtepu8_epi16(clear), high_bytes);
+                __m128i const clear1 = _mm_or_si128(_mm_cvtepu8_epi16(_mm_srli_si128(clear, 8)), high_bytes);
+
+                __m128i img0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(location));
+                __m128i img1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(location + 16));
+                img0 = _mm_or_si128(_mm_and_si128(img0, clear0), _mm_cvtepu8_epi16(value));
+                img1 = _mm_or_si128(_mm_and_si128(img1, clear1), _mm_cvtepu8_epi16(_mm_srli_si128(value, 8)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(location), img0);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(location + 16), img1);
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static auto load_image_avx2(ice::postcard::u8 const* location) noexcept -> __m256i
+        {
+            if constexpr (Depth == 1)
+            {
+                return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(location));
+            }
+            else
+            {
+                // Packing works on each 128 bit lane, the permute restores the channel order.
+                __m256i const low_bytes = _mm256_set1_epi16(0x00ff);
+                __m256i const v0 = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(location)), low_bytes);
+                __m256i const v1 = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(location + 32)), low_bytes);
+                return _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xd8);
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void update_image_avx2(ice::postcard::u8* location, __m256i clear, __m256i value) noexcept
+        {
+            if constexpr (Depth == 1)
+            {
+                __m256i img = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(location));
+                img = _mm256_or_si256(_mm256_and_si256(img, clear), value);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(location), img);
+            }
+            else
+            {
+                __m256i const high_bytes = _mm256_set1_epi16(short(0xff00));
+                __m256i const clear0 = _mm256_or_si256(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(clear)), high_bytes);
+                __m256i const clear1 = _mm256_or_si256(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(clear, 1)), high_bytes);
+                __m256i const value0 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(value));
+                __m256i const value1 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(value, 1));
+
+                __m256i img0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(location));
+                __m256i img1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(location + 32));
+                img0 = _mm256_or_si256(_mm256_and_si256(img0, clear0), value0);
+                img1 = _mm256_or_si256(_mm256_and_si256(img1, clear1), value1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(location), img0);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(location + 32), img1);
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static auto load_image_avx512(ice::postcard::u8 const* location) noexcept -> __m512i
+        {
+            if constexpr (Depth == 1)
+            {
+                return _mm512_loadu_si512(location);
+            }
+            else
+            {
+                __m256i const v0 = _mm512_cvtepi16_epi8(_mm512_loadu_si512(location));
+                __m256i const v1 = _mm512_cvtepi16_epi8(_mm512_loadu_si512(location + 64));
+                return _mm512_inserti64x4(_mm512_castsi256_si512(v0), v1, 1);
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void update_image_avx512(ice::postcard::u8* location, __m512i clear, __m512i value) noexcept
+        {
+            if constexpr (Depth == 1)
+            {
+                __m512i img = _mm512_loadu_si512(location);
+                img = _mm512_or_si512(_mm512_and_si512(img, clear), value);
+                _mm512_storeu_si512(location, img);
+            }
+            else
+            {
+                __m512i const high_bytes = _mm512_set1_epi16(short(0xff00));
+                __m512i const clear0 = _mm512_or_si512(_mm512_cvtepu8_epi16(_mm512_castsi512_si256(clear)), high_bytes);
+                __m512i const clear1 = _mm512_or_si512(_mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(clear, 1)), high_bytes);
+                __m512i const value0 = _mm512_cvtepu8_epi16(_mm512_castsi512_si256(value));
+                __m512i const value1 = _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(value, 1));
+
+                __m512i img0 = _mm512_loadu_si512(location);
+                __m512i img1 = _mm512_loadu_si512(location + 64);
+                img0 = _mm512_or_si512(_mm512_and_si512(img0, clear0), value0);
+                img1 = _mm512_or_si512(_mm512_and_si512(img1, clear1), value1);
+                _mm512_storeu_si512(location, img0);
+                _mm512_storeu_si512(location + 64, img1);
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void write_postcard_data_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_copy_lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentCopyMask));
+            __m128i const sse_mask_copy_hi = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentCopyMask + 16));
+            __m128i const sse_mask_select = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_BitSelectorMask));
+            __m128i const sse_mask_lsb_clear = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelClearMask));
+            __m128i const sse_mask_lsb_keep = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelKeepMask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                ice::postcard::u32 word;
+                std::memcpy(&word, source, sizeof(word));
+
+                // Duplicate each of the four bytes into 8 entries each (8 bits extracted), two bytes per register.
+                __m128i const v = _mm_set1_epi32(int(word));
+                __m128i v0 = _mm_shuffle_epi8(v, sse_mask_copy_lo);
+                __m128i v1 = _mm_shuffle_epi8(v, sse_mask_copy_hi);
+                // Keep only the required bit for each 8bit entry and check if it is set
+                v0 = _mm_cmpeq_epi8(_mm_and_si128(v0, sse_mask_select), sse_mask_select);
+                v1 = _mm_cmpeq_epi8(_mm_and_si128(v1, sse_mask_select), sse_mask_select);
+                // Keep only the LSB bit after the check
+                v0 = _mm_and_si128(v0, sse_mask_lsb_keep);
+                v1 = _mm_and_si128(v1, sse_mask_lsb_keep);
+
+                // Clear the LSB bit of the image channels and set it with our own data.
+                update_image_sse41<Depth>(destination, sse_mask_lsb_clear, v0);
+                update_image_sse41<Depth>(destination + 16 * Depth, sse_mask_lsb_clear, v1);
+
+                source += 4;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void read_postcard_data_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i v0 = load_image_sse41<Depth>(source);
+                __m128i v1 = load_image_sse41<Depth>(source + 16 * Depth);
+
+                // Move the LSB into the MSB of each byte, so we can gather them with a single movemask.
+                v0 = _mm_slli_epi16(v0, 7);
+                v1 = _mm_slli_epi16(v1, 7);
+
+                ice::postcard::u32 const word = ice::postcard::u32(_mm_movemask_epi8(v0))
+                    | (ice::postcard::u32(_mm_movemask_epi8(v1)) << 16);
+                std::memcpy(destination, &word, sizeof(word));
+
+                source += 32 * Depth;
+                destination += 4;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void write_postcard_data_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_copy = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_ComponentCopyMask));
+            __m256i const avx_mask_select = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_BitSelectorMask));
+            __m256i const avx_mask_lsb_clear = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_LSBChannelClearMask));
+            __m256i const avx_mask_lsb_keep = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_LSBChannelKeepMask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                ice::postcard::u32 word;
+                std::memcpy(&word, source, sizeof(word));
+
+                // The word is repeated in both 128bit lanes, so the in-lane shuffle can reach all four bytes.
+                __m256i v = _mm256_set1_epi32(int(word));
+                v = _mm256_shuffle_epi8(v, avx_mask_copy);
+                v = _mm256_cmpeq_epi8(_mm256_and_si256(v, avx_mask_select), avx_mask_select);
+                v = _mm256_and_si256(v, avx_mask_lsb_keep);
+
+                update_image_avx2<Depth>(destination, avx_mask_lsb_clear, v);
+
+                source += 4;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void read_postcard_data_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i v = load_image_avx2<Depth>(source);
+                v = _mm256_slli_epi16(v, 7);
+
+                ice::postcard::u32 const word = ice::postcard::u32(_mm256_movemask_epi8(v));
+                std::memcpy(destination, &word, sizeof(word));
+
+                source += 32 * Depth;
+                destination += 4;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void write_postcard_data_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_lsb_clear = _mm512_set1_epi8(char(0xfe));
+            __m512i const avx_lsb_keep = _mm512_set1_epi8(0x01);
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                // Eight payload bytes are exactly one mask register, bit N selects the LSB of channel N.
+                ice::postcard::u64 bits;
+                std::memcpy(&bits, source, sizeof(bits));
+
+                update_image_avx512<Depth>(destination, avx_lsb_clear, _mm512_maskz_mov_epi8(__mmask64(bits), avx_lsb_keep));
+
+                source += 8;
+                destination += 64 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void read_postcard_data_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_lsb_keep = _mm512_set1_epi8(0x01);
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m512i const img = load_image_avx512<Depth>(source);
+                ice::postcard::u64 const bits = _mm512_test_epi8_mask(img, avx_lsb_keep);
+                std::memcpy(destination, &bits, sizeof(bits));
+
+                source += 64 * Depth;
+                destination += 8;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void write_postcard_data_rgba_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_copy_lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentCopy4Mask));
+            __m128i const sse_mask_copy_hi = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentCopy4Mask + 16));
+            __m128i const sse_mask_select_lo = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_BitSelector4Mask));
+            __m128i const sse_mask_select_hi = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_BitSelector4Mask + 16));
+            __m128i const sse_mask_lsb_clear = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelClear4Mask));
+            __m128i const sse_mask_lsb_keep = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_LSBChannelKeepMask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                ice::postcard::u32 const word = ice::postcard::u32(source[0])
+                    | (ice::postcard::u32(source[1]) << 8)
+                    | (ice::postcard::u32(source[2]) << 16);
+
+                __m128i const v = _mm_set1_epi32(int(word));
+                __m128i v0 = _mm_shuffle_epi8(v, sse_mask_copy_lo);
+                __m128i v1 = _mm_shuffle_epi8(v, sse_mask_copy_hi);
+                // Alpha entries have an empty selector, so 'min' leaves them at zero while color entries become 0 or 1.
+                v0 = _mm_min_epu8(_mm_and_si128(v0, sse_mask_select_lo), sse_mask_lsb_keep);
+                v1 = _mm_min_epu8(_mm_and_si128(v1, sse_mask_select_hi), sse_mask_lsb_keep);
+
+                update_image_sse41<Depth>(destination, sse_mask_lsb_clear, v0);
+                update_image_sse41<Depth>(destination + 16 * Depth, sse_mask_lsb_clear, v1);
+
+                source += 3;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void read_postcard_data_rgba_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_read = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentRead4Mask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i v0 = load_image_sse41<Depth>(source);
+                __m128i v1 = load_image_sse41<Depth>(source + 16 * Depth);
+
+                // Drop the alpha channels, leaving 12 color channels in each register.
+                v0 = _mm_slli_epi16(_mm_shuffle_epi8(v0, sse_mask_read), 7);
+                v1 = _mm_slli_epi16(_mm_shuffle_epi8(v1, sse_mask_read), 7);
+
+                ice::postcard::u32 const word = ice::postcard::u32(_mm_movemask_epi8(v0))
+                    | (ice::postcard::u32(_mm_movemask_epi8(v1)) << 12);
+                destination[0] = ice::postcard::u8(word);
+                destination[1] = ice::postcard::u8(word >> 8);
+                destination[2] = ice::postcard::u8(word >> 16);
+
+                source += 32 * Depth;
+                destination += 3;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void write_postcard_data_rgba_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_copy = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_ComponentCopy4Mask));
+            __m256i const avx_mask_select = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_BitSelector4Mask));
+            __m256i const avx_mask_lsb_clear = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_LSBChannelClear4Mask));
+            __m256i const avx_mask_lsb_keep = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_LSBChannelKeepMask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                ice::postcard::u32 const word = ice::postcard::u32(source[0])
+                    | (ice::postcard::u32(source[1]) << 8)
+                    | (ice::postcard::u32(source[2]) << 16);
+
+                __m256i v = _mm256_set1_epi32(int(word));
+                v = _mm256_shuffle_epi8(v, avx_mask_copy);
+                v = _mm256_min_epu8(_mm256_and_si256(v, avx_mask_select), avx_mask_lsb_keep);
+
+                update_image_avx2<Depth>(destination, avx_mask_lsb_clear, v);
+
+                source += 3;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void read_postcard_data_rgba_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_read = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_ComponentRead4Mask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i v = load_image_avx2<Depth>(source);
+                v = _mm256_slli_epi16(_mm256_shuffle_epi8(v, avx_mask_read), 7);
+
+                // Each 128bit lane holds 12 color bits in its lower part.
+                ice::postcard::u32 const mask = ice::postcard::u32(_mm256_movemask_epi8(v));
+                ice::postcard::u32 const word = (mask & 0x0fff) | ((mask >> 4) & 0xff'f000);
+                destination[0] = ice::postcard::u8(word);
+                destination[1] = ice::postcard::u8(word >> 8);
+                destination[2] = ice::postcard::u8(word >> 16);
+
+                source += 32 * Depth;
+                destination += 3;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void write_postcard_data_rgba_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            // Same pattern as 'Constant_LSBChannelClear4Mask', repeated for each pixel.
+            __m512i const avx_lsb_clear = _mm512_set1_epi32(int(0xfffe'fefe));
+            __m512i const avx_lsb_keep = _mm512_set1_epi8(0x01);
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                // Six payload bytes cover 16 pixels, deposit the bits so every fourth (alpha) entry stays empty.
+                ice::postcard::u64 bits = 0;
+                std::memcpy(&bits, source, 6);
+                bits = _pdep_u64(bits, detail::simd::Constant_ColorChannelBits4);
+
+                update_image_avx512<Depth>(destination, avx_lsb_clear, _mm512_maskz_mov_epi8(__mmask64(bits), avx_lsb_keep));
+
+                source += 6;
+                destination += 64 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void read_postcard_data_rgba_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_lsb_keep = _mm512_set1_epi8(0x01);
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m512i const img = load_image_avx512<Depth>(source);
+                ice::postcard::u64 const mask = _mm512_test_epi8_mask(img, avx_lsb_keep);
+                ice::postcard::u64 const bits = _pext_u64(mask, detail::simd::Constant_ColorChannelBits4);
+                std::memcpy(destination, &bits, 6);
+
+                source += 64 * Depth;
+                destination += 6;
+            }
+        }
+
+        // Kernels for the dense modes, storing 2 or 4 bits in each channel. The lowest bits of a byte go into the first channel.
+
+        //! \brief Spreads the nibbles of the lower 8 bytes over 16 entries.
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static auto expand_nibbles_sse41(__m128i bytes) noexcept -> __m128i
+        {
+            __m128i const v = _mm_cvtepu8_epi16(bytes);
+            return _mm_and_si128(_mm_or_si128(v, _mm_slli_epi16(v, 4)), _mm_set1_epi8(0x0f));
+        }
+
+        //! \brief Spreads the bit pairs of the lower 4 bytes over 16 entries.
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static auto expand_pairs_sse41(__m128i bytes) noexcept -> __m128i
+        {
+            __m128i const v = _mm_cvtepu8_epi32(bytes);
+            __m128i const lo = _mm_or_si128(v, _mm_slli_epi32(v, 6));
+            __m128i const hi = _mm_or_si128(_mm_slli_epi32(v, 12), _mm_slli_epi32(v, 18));
+            return _mm_and_si128(_mm_or_si128(lo, hi), _mm_set1_epi8(0x03));
+        }
+
+        //! \brief Joins the nibbles of 16 entries into the lower 8 bytes.
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static auto gather_nibbles_sse41(__m128i channels) noexcept -> __m128i
+        {
+            __m128i v = _mm_and_si128(channels, _mm_set1_epi8(0x0f));
+            v = _mm_and_si128(_mm_or_si128(v, _mm_srli_epi16(v, 4)), _mm_set1_epi16(0x00ff));
+            return _mm_packus_epi16(v, v);
+        }
+
+        //! \brief Joins the bit pairs of 16 entries into the lower 4 bytes.
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static auto gather_pairs_sse41(__m128i channels) noexcept -> __m128i
+        {
+            __m128i v = _mm_and_si128(channels, _mm_set1_epi8(0x03));
+            __m128i const lo = _mm_or_si128(v, _mm_srli_epi32(v, 6));
+            __m128i const hi = _mm_or_si128(_mm_srli_epi32(v, 12), _mm_srli_epi32(v, 18));
+            v = _mm_and_si128(_mm_or_si128(lo, hi), _mm_set1_epi32(0x0000'00ff));
+            v = _mm_packus_epi32(v, v);
+            return _mm_packus_epi16(v, v);
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void write_postcard_data_nibbles_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_clear = _mm_set1_epi8(char(0xf0));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i const v = expand_nibbles_sse41(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(source)));
+
+                update_image_sse41<Depth>(destination, sse_mask_clear, v);
+
+                source += 8;
+                destination += 16 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void read_postcard_data_nibbles_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i const v = gather_nibbles_sse41(load_image_sse41<Depth>(source));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(destination), v);
+
+                source += 16 * Depth;
+                destination += 8;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void write_postcard_data_pairs_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_clear = _mm_set1_epi8(char(0xfc));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                ice::postcard::u32 word;
+                std::memcpy(&word, source, sizeof(word));
+                __m128i const v = expand_pairs_sse41(_mm_cvtsi32_si128(int(word)));
+
+                update_image_sse41<Depth>(destination, sse_mask_clear, v);
+
+                source += 4;
+                destination += 16 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void read_postcard_data_pairs_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i const v = gather_pairs_sse41(load_image_sse41<Depth>(source));
+                ice::postcard::u32 const word = ice::postcard::u32(_mm_cvtsi128_si32(v));
+                std::memcpy(destination, &word, sizeof(word));
+
+                source += 16 * Depth;
+                destination += 4;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void write_postcard_data_rgba_nibbles_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_spread = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentSpread4Mask));
+            __m128i const sse_mask_clear = _mm_set1_epi32(int(0xfff0'f0f0));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                // Six payload bytes are the 12 color channels of 4 pixels.
+                ice::postcard::u64 bytes = 0;
+                std::memcpy(&bytes, source, 6);
+                __m128i const v = _mm_shuffle_epi8(expand_nibbles_sse41(_mm_cvtsi64_si128(ice::postcard::i64(bytes))), sse_mask_spread);
+
+                update_image_sse41<Depth>(destination, sse_mask_clear, v);
+
+                source += 6;
+                destination += 16 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void read_postcard_data_rgba_nibbles_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_read = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentRead4Mask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i v = _mm_shuffle_epi8(load_image_sse41<Depth>(source), sse_mask_read);
+                v = gather_nibbles_sse41(v);
+
+                ice::postcard::u64 const bytes = ice::postcard::u64(_mm_cvtsi128_si64(v));
+                std::memcpy(destination, &bytes, 6);
+
+                source += 16 * Depth;
+                destination += 6;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void write_postcard_data_rgba_pairs_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_spread = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentSpread4Mask));
+            __m128i const sse_mask_clear = _mm_set1_epi32(int(0xfffc'fcfc));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                ice::postcard::u32 const word = ice::postcard::u32(source[0])
+                    | (ice::postcard::u32(source[1]) << 8)
+                    | (ice::postcard::u32(source[2]) << 16);
+                __m128i const v = _mm_shuffle_epi8(expand_pairs_sse41(_mm_cvtsi32_si128(int(word))), sse_mask_spread);
+
+                update_image_sse41<Depth>(destination, sse_mask_clear, v);
+
+                source += 3;
+                destination += 16 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("ssse3,sse4.1")
+        static void read_postcard_data_rgba_pairs_sse41(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m128i const sse_mask_read = _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentRead4Mask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i v = _mm_shuffle_epi8(load_image_sse41<Depth>(source), sse_mask_read);
+                ice::postcard::u32 const word = ice::postcard::u32(_mm_cvtsi128_si32(gather_pairs_sse41(v)));
+                destination[0] = ice::postcard::u8(word);
+                destination[1] = ice::postcard::u8(word >> 8);
+                destination[2] = ice::postcard::u8(word >> 16);
+
+                source += 16 * Depth;
+                destination += 3;
+            }
+        }
+
+        ICE_POSTCARD_TARGET("avx2")
+        static auto expand_nibbles_avx2(__m128i bytes) noexcept -> __m256i
+        {
+            __m256i const v = _mm256_cvtepu8_epi16(bytes);
+            return _mm256_and_si256(_mm256_or_si256(v, _mm256_slli_epi16(v, 4)), _mm256_set1_epi8(0x0f));
+        }
+
+        ICE_POSTCARD_TARGET("avx2")
+        static auto expand_pairs_avx2(__m128i bytes) noexcept -> __m256i
+        {
+            __m256i const v = _mm256_cvtepu8_epi32(bytes);
+            __m256i const lo = _mm256_or_si256(v, _mm256_slli_epi32(v, 6));
+            __m256i const hi = _mm256_or_si256(_mm256_slli_epi32(v, 12), _mm256_slli_epi32(v, 18));
+            return _mm256_and_si256(_mm256_or_si256(lo, hi), _mm256_set1_epi8(0x03));
+        }
+
+        //! \brief Joins the nibbles of each 128bit lane into the lower 8 bytes of the same lane.
+        ICE_POSTCARD_TARGET("avx2")
+        static auto gather_nibbles_avx2(__m256i channels) noexcept -> __m256i
+        {
+            __m256i v = _mm256_and_si256(channels, _mm256_set1_epi8(0x0f));
+            v = _mm256_and_si256(_mm256_or_si256(v, _mm256_srli_epi16(v, 4)), _mm256_set1_epi16(0x00ff));
+            return _mm256_packus_epi16(v, v);
+        }
+
+        //! \brief Joins the bit pairs of each 128bit lane into the lower 4 bytes of the same lane.
+        ICE_POSTCARD_TARGET("avx2")
+        static auto gather_pairs_avx2(__m256i channels) noexcept -> __m256i
+        {
+            __m256i v = _mm256_and_si256(channels, _mm256_set1_epi8(0x03));
+            __m256i const lo = _mm256_or_si256(v, _mm256_srli_epi32(v, 6));
+            __m256i const hi = _mm256_or_si256(_mm256_srli_epi32(v, 12), _mm256_srli_epi32(v, 18));
+            v = _mm256_and_si256(_mm256_or_si256(lo, hi), _mm256_set1_epi32(0x0000'00ff));
+            v = _mm256_packus_epi32(v, v);
+            return _mm256_packus_epi16(v, v);
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void write_postcard_data_nibbles_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_clear = _mm256_set1_epi8(char(0xf0));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i const v = expand_nibbles_avx2(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source)));
+
+                update_image_avx2<Depth>(destination, avx_mask_clear, v);
+
+                source += 16;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void read_postcard_data_nibbles_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i v = gather_nibbles_avx2(load_image_avx2<Depth>(source));
+                // Move the lower halves of both lanes next to each other.
+                v = _mm256_permute4x64_epi64(v, 0b10'00'10'00);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm256_castsi256_si128(v));
+
+                source += 32 * Depth;
+                destination += 16;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void write_postcard_data_pairs_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_clear = _mm256_set1_epi8(char(0xfc));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i const v = expand_pairs_avx2(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(source)));
+
+                update_image_avx2<Depth>(destination, avx_mask_clear, v);
+
+                source += 8;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void read_postcard_data_pairs_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_join = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i v = gather_pairs_avx2(load_image_avx2<Depth>(source));
+                v = _mm256_permutevar8x32_epi32(v, avx_mask_join);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(destination), _mm256_castsi256_si128(v));
+
+                source += 32 * Depth;
+                destination += 8;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void write_postcard_data_rgba_nibbles_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_spread = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentSpread4Mask))
+            );
+            __m256i const avx_mask_clear = _mm256_set1_epi32(int(0xfff0'f0f0));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                // Each 128bit lane takes six payload bytes, so the in-lane shuffle can spread them over 4 pixels.
+                ice::postcard::u64 lo = 0, hi = 0;
+                std::memcpy(&lo, source, 6);
+                std::memcpy(&hi, source + 6, 6);
+
+                __m256i v = expand_nibbles_avx2(_mm_set_epi64x(ice::postcard::i64(hi), ice::postcard::i64(lo)));
+                v = _mm256_shuffle_epi8(v, avx_mask_spread);
+
+                update_image_avx2<Depth>(destination, avx_mask_clear, v);
+
+                source += 12;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void read_postcard_data_rgba_nibbles_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_read = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_ComponentRead4Mask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i v = _mm256_shuffle_epi8(load_image_avx2<Depth>(source), avx_mask_read);
+                v = gather_nibbles_avx2(v);
+
+                ice::postcard::u64 const lo = ice::postcard::u64(_mm_cvtsi128_si64(_mm256_castsi256_si128(v)));
+                ice::postcard::u64 const hi = ice::postcard::u64(_mm_cvtsi128_si64(_mm256_extracti128_si256(v, 1)));
+                std::memcpy(destination, &lo, 6);
+                std::memcpy(destination + 6, &hi, 6);
+
+                source += 32 * Depth;
+                destination += 12;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void write_postcard_data_rgba_pairs_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_spread = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentSpread4Mask))
+            );
+            __m256i const avx_mask_clear = _mm256_set1_epi32(int(0xfffc'fcfc));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                // Each 128bit lane takes three payload bytes.
+                ice::postcard::u32 lo = 0, hi = 0;
+                std::memcpy(&lo, source, 3);
+                std::memcpy(&hi, source + 3, 3);
+
+                __m256i v = expand_pairs_avx2(_mm_cvtsi64_si128(ice::postcard::i64(lo | (ice::postcard::u64(hi) << 32))));
+                v = _mm256_shuffle_epi8(v, avx_mask_spread);
+
+                update_image_avx2<Depth>(destination, avx_mask_clear, v);
+
+                source += 6;
+                destination += 32 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx2")
+        static void read_postcard_data_rgba_pairs_avx2(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m256i const avx_mask_read = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(detail::simd::Constant_ComponentRead4Mask));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i v = _mm256_shuffle_epi8(load_image_avx2<Depth>(source), avx_mask_read);
+                v = gather_pairs_avx2(v);
+
+                ice::postcard::u32 const lo = ice::postcard::u32(_mm_cvtsi128_si32(_mm256_castsi256_si128(v)));
+                ice::postcard::u32 const hi = ice::postcard::u32(_mm_cvtsi128_si32(_mm256_extracti128_si256(v, 1)));
+                std::memcpy(destination, &lo, 3);
+                std::memcpy(destination + 3, &hi, 3);
+
+                source += 32 * Depth;
+                destination += 6;
+            }
+        }
+
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static auto expand_nibbles_avx512(__m256i bytes) noexcept -> __m512i
+        {
+            __m512i const v = _mm512_cvtepu8_epi16(bytes);
+            return _mm512_and_si512(_mm512_or_si512(v, _mm512_slli_epi16(v, 4)), _mm512_set1_epi8(0x0f));
+        }
+
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static auto expand_pairs_avx512(__m128i bytes) noexcept -> __m512i
+        {
+            __m512i const v = _mm512_cvtepu8_epi32(bytes);
+            __m512i const lo = _mm512_or_si512(v, _mm512_slli_epi32(v, 6));
+            __m512i const hi = _mm512_or_si512(_mm512_slli_epi32(v, 12), _mm512_slli_epi32(v, 18));
+            return _mm512_and_si512(_mm512_or_si512(lo, hi), _mm512_set1_epi8(0x03));
+        }
+
+        //! \brief Joins the nibbles of 64 entries into 32 bytes.
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static auto gather_nibbles_avx512(__m512i channels) noexcept -> __m256i
+        {
+            __m512i const v = _mm512_and_si512(channels, _mm512_set1_epi8(0x0f));
+            return _mm512_cvtepi16_epi8(_mm512_or_si512(v, _mm512_srli_epi16(v, 4)));
+        }
+
+        //! \brief Joins the bit pairs of 64 entries into 16 bytes.
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static auto gather_pairs_avx512(__m512i channels) noexcept -> __m128i
+        {
+            __m512i const v = _mm512_and_si512(channels, _mm512_set1_epi8(0x03));
+            __m512i const lo = _mm512_or_si512(v, _mm512_srli_epi32(v, 6));
+            __m512i const hi = _mm512_or_si512(_mm512_srli_epi32(v, 12), _mm512_srli_epi32(v, 18));
+            return _mm512_cvtepi32_epi8(_mm512_or_si512(lo, hi));
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void write_postcard_data_nibbles_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_mask_clear = _mm512_set1_epi8(char(0xf0));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m512i const v = expand_nibbles_avx512(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(source)));
+
+                update_image_avx512<Depth>(destination, avx_mask_clear, v);
+
+                source += 32;
+                destination += 64 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void read_postcard_data_nibbles_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m256i const v = gather_nibbles_avx512(load_image_avx512<Depth>(source));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), v);
+
+                source += 64 * Depth;
+                destination += 32;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void write_postcard_data_pairs_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_mask_clear = _mm512_set1_epi8(char(0xfc));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m512i const v = expand_pairs_avx512(_mm_loadu_si128(reinterpret_cast<__m128i const*>(source)));
+
+                update_image_avx512<Depth>(destination, avx_mask_clear, v);
+
+                source += 16;
+                destination += 64 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void read_postcard_data_pairs_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m128i const v = gather_pairs_avx512(load_image_avx512<Depth>(source));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), v);
+
+                source += 64 * Depth;
+                destination += 16;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void write_postcard_data_rgba_nibbles_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_mask_spread = _mm512_broadcast_i32x4(
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentSpread4Mask))
+            );
+            __m512i const avx_mask_clear = _mm512_set1_epi32(int(0xfff0'f0f0));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                // Each 128bit lane takes six payload bytes, widened from its own 8 byte slot.
+                ice::postcard::u64 slots[4]{ };
+                for (ice::postcard::u32 lane = 0; lane < 4; lane += 1)
+                {
+                    std::memcpy(slots + lane, source + lane * 6, 6);
+                }
+
+                __m512i v = expand_nibbles_avx512(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(slots)));
+                v = _mm512_shuffle_epi8(v, avx_mask_spread);
+
+                update_image_avx512<Depth>(destination, avx_mask_clear, v);
+
+                source += 24;
+                destination += 64 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void read_postcard_data_rgba_nibbles_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_mask_read = _mm512_broadcast_i32x4(
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentRead4Mask))
+            );
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m512i const v = _mm512_shuffle_epi8(load_image_avx512<Depth>(source), avx_mask_read);
+
+                ice::postcard::u64 slots[4];
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(slots), gather_nibbles_avx512(v));
+                for (ice::postcard::u32 lane = 0; lane < 4; lane += 1)
+                {
+                    std::memcpy(destination + lane * 6, slots + lane, 6);
+                }
+
+                source += 64 * Depth;
+                destination += 24;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void write_postcard_data_rgba_pairs_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_mask_spread = _mm512_broadcast_i32x4(
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentSpread4Mask))
+            );
+            __m512i const avx_mask_clear = _mm512_set1_epi32(int(0xfffc'fcfc));
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                // Each 128bit lane takes three payload bytes, widened from its own 4 byte slot.
+                ice::postcard::u32 slots[4]{ };
+                for (ice::postcard::u32 lane = 0; lane < 4; lane += 1)
+                {
+                    std::memcpy(slots + lane, source + lane * 3, 3);
+                }
+
+                __m512i v = expand_pairs_avx512(_mm_loadu_si128(reinterpret_cast<__m128i const*>(slots)));
+                v = _mm512_shuffle_epi8(v, avx_mask_spread);
+
+                update_image_avx512<Depth>(destination, avx_mask_clear, v);
+
+                source += 12;
+                destination += 64 * Depth;
+            }
+        }
+
+        template<ice::postcard::u8 Depth>
+        ICE_POSTCARD_TARGET("avx512f,avx512bw,bmi2")
+        static void read_postcard_data_rgba_pairs_avx512(
+            ice::postcard::u8* destination,
+            ice::postcard::u8 const* source,
+            ice::postcard::usize blocks
+        ) noexcept
+        {
+            __m512i const avx_mask_read = _mm512_broadcast_i32x4(
+                _mm_loadu_si128(reinterpret_cast<__m128i const*>(detail::simd::Constant_ComponentRead4Mask))
+            );
+
+            for (ice::postcard::usize block = 0; block < blocks; block += 1)
+            {
+                __m512i const v = _mm512_shuffle_epi8(load_image_avx512<Depth>(source), avx_mask_read);
+
+                ice::postcard::u32 slots[4];
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(slots), gather_pairs_avx512(v));
+                for (ice::postcard::u32 lane = 0; lane < 4; lane += 1)
+                {
+                    std::memcpy(destination + lane * 3, slots + lane, 3);
+                }
+
+                source += 64 * Depth;
+                destination += 12;
+            }
+        }
+
+        using KernelFn = void(*)(ice::postcard::u8*, ice::postcard::u8 const*, ice::postcard::usize) noexcept;
+
+        struct Kernel
+        {
+            KernelFn fn;
+            ice::postcard::usize payload_block; // Payload bytes processed per iteration
+            ice::postcard::usize image_block; // Image bytes processed per iteration
+        };
+
+        // Indexed by [density][is_rgba][isa - 1], where density is 0, 1 and 2 for 1, 2 and 4 bits per channel.
+        //   Depth is the size of a single channel in bytes.
+        template<ice::postcard::u8 Depth>
+        static constexpr Kernel Constant_WriteKernels[3][2][3]{
+            {
+                {
+                    { write_postcard_data_sse41<Depth>, 4, 32 * Depth },
+                    { write_postcard_data_avx2<Depth>, 4, 32 * Depth },
+                    { write_postcard_data_avx512<Depth>, 8, 64 * Depth },
+                },
+                {
+                    { write_postcard_data_rgba_sse41<Depth>, 3, 32 * Depth },
+                    { write_postcard_data_rgba_avx2<Depth>, 3, 32 * Depth },
+                    { write_postcard_data_rgba_avx512<Depth>, 6, 64 * Depth },
+                },
+            },
+            {
+                {
+                    { write_postcard_data_pairs_sse41<Depth>, 4, 16 * Depth },
+                    { write_postcard_data_pairs_avx2<Depth>, 8, 32 * Depth },
+                    { write_postcard_data_pairs_avx512<Depth>, 16, 64 * Depth },
+                },
+                {
+                    { write_postcard_data_rgba_pairs_sse41<Depth>, 3, 16 * Depth },
+                    { write_postcard_data_rgba_pairs_avx2<Depth>, 6, 32 * Depth },
+                    { write_postcard_data_rgba_pairs_avx512<Depth>, 12, 64 * Depth },
+                },
+            },
+            {
+                {
+                    { write_postcard_data_nibbles_sse41<Depth>, 8, 16 * Depth },
+                    { write_postcard_data_nibbles_avx2<Depth>, 16, 32 * Depth },
+                    { write_postcard_data_nibbles_avx512<Depth>, 32, 64 * Depth },
+                },
+                {
+                    { write_postcard_data_rgba_nibbles_sse41<Depth>, 6, 16 * Depth },
+                    { write_postcard_data_rgba_nibbles_avx2<Depth>, 12, 32 * Depth },
+                    { write_postcard_data_rgba_nibbles_avx512<Depth>, 24, 64 * Depth },
+                },
+            },
+        };
+
+        template<ice::postcard::u8 Depth>
+        static constexpr Kernel Constant_ReadKernels[3][2][3]{
+            {
+                {
+                    { read_postcard_data_sse41<Depth>, 4, 32 * Depth },
+                    { read_postcard_data_avx2<Depth>, 4, 32 * Depth },
+                    { read_postcard_data_avx512<Depth>, 8, 64 * Depth },
+                },
+                {
+                    { read_postcard_data_rgba_sse41<Depth>, 3, 32 * Depth },
+                    { read_postcard_data_rgba_avx2<Depth>, 3, 32 * Depth },
+                    { read_postcard_data_rgba_avx512<Depth>, 6, 64 * Depth },
+                },
+            },
+            {
+                {
+                    { read_postcard_data_pairs_sse41<Depth>, 4, 16 * Depth },
+                    { read_postcard_data_pairs_avx2<Depth>, 8, 32 * Depth },
+                    { read_postcard_data_pairs_avx512<Depth>, 16, 64 * Depth },
+                },
+                {
+                    { read_postcard_data_rgba_pairs_sse41<Depth>, 3, 16 * Depth },
+                    { read_postcard_data_rgba_pairs_avx2<Depth>, 6, 32 * Depth },
+                    { read_postcard_data_rgba_pairs_avx512<Depth>, 12, 64 * Depth },
+                },
+            },
+            {
+                {
+                    { read_postcard_data_nibbles_sse41<Depth>, 8, 16 * Depth },
+                    { read_postcard_data_nibbles_avx2<Depth>, 16, 32 * Depth },
+                    { read_postcard_data_nibbles_avx512<Depth>, 32, 64 * Depth },
+                },
+                {
+                    { read_postcard_data_rgba_nibbles_sse41<Depth>, 6, 16 * Depth },
+                    { read_postcard_data_rgba_nibbles_avx2<Depth>, 12, 32 * Depth },
+                    { read_postcard_data_rgba_nibbles_avx512<Depth>, 24, 64 * Depth },
+                },
+            },
+        };
+
+        static auto density_index(ice::postcard::u8 bits) noexcept -> ice::postcard::u32
+        {
+            return bits == 4 ? 2 : bits == 2 ? 1 : 0;
+        }
+
+        //! \brief Kernels for 4 channel images need to start on the first channel of a pixel.
+        //! \returns 'false' if the last channel is in the middle of a pixel.
+        static bool is_pixel_aligned(ice::postcard::u8 channel_count, ice::postcard::u8 last_channel) noexcept
+        {
+            return channel_count != 4 || last_channel == 0 || last_channel == 3;
+        }
+
+    } // namespace detail::simd
+
+    namespace detail::simd
+    {
+
+        static auto isa_limit() noexcept -> ice::postcard::detail::simd::Isa&
+        {
+            static ice::postcard::detail::simd::Isa limit = Isa::AVX512;
+            return limit;
+        }
+
+    } // namespace detail::simd
+
+    auto detail::simd::selected_isa() noexcept -> ice::postcard::detail::simd::Isa
+    {
+        static ice::postcard::detail::simd::Isa const isa = detect_isa();
+        return std::min(isa, isa_limit());
+    }
+
+    void detail::simd::limit_isa(ice::postcard::detail::simd::Isa isa) noexcept
+    {
+        isa_limit() = isa;
+    }
+
+    auto detail::simd::write_postcard_data(
+        ice::postcard::Memory target,
+        ice::postcard::Data& source,
+        ice::postcard::u8 channel_count,
+        ice::postcard::u8 channel_size,
+        ice::postcard::u8 bits,
+        ice::postcard::u8& out_last_written_channel
+    ) noexcept -> ice::postcard::usize
+    {
+        ice::postcard::u8 const isa = ice::postcard::u8(selected_isa());
+        if (isa == 0 || is_pixel_aligned(channel_count, out_last_written_channel) == false)
+        {
+            return 0;
+        }
+
+        Kernel const (&kernels)[3] = channel_size == 2
+            ? Constant_WriteKernels<2>[density_index(bits)][channel_count == 4]
+            : Constant_WriteKernels<1>[density_index(bits)][channel_count == 4];
+        if (source.size < kernels[0].payload_block)
+        {
+            return 0;
+        }
+
+        ice::postcard::u8* destination = reinterpret_cast<ice::postcard::u8*>(target.location);
+        ice::postcard::u8 const* source_bytes = reinterpret_cast<ice::postcard::u8 const*>(source.location);
+        ice::postcard::u8 const* const start = destination;
+        ice::postcard::usize bytes_to_write = source.size;
+
+        // Skip the alpha channel if we stopped right before it.
+        if (out_last_written_channel == 3)
+        {
+            destination += channel_size;
+            out_last_written_channel = 0;
+        }
+
+        // Each kernel takes as many blocks as it can, and leaves the rest to the next narrower one.
+        for (ice::postcard::u8 idx = isa; idx > 0; idx -= 1)
+        {
+            Kernel const& kernel = kernels[idx - 1];
+            ice::postcard::usize const blocks = bytes_to_write / kernel.payload_block;
+            kernel.fn(destination, source_bytes, blocks);
+            destination += blocks * kernel.image_block;
+            source_bytes += blocks * kernel.payload_block;
+            bytes_to_write -= blocks * kernel.payload_block;
+        }
+
+        assert(ice::postcard::usize(destination - start) <= target.size);
+        source = { source_bytes, bytes_to_write };
+        return ice::postcard::usize(destination - start);
+    }
+
+    auto detail::simd::read_postcard_data(
+        ice::postcard::Memory& target,
+        ice::postcard::Data source,
+        ice::postcard::u8 channel_count,
+        ice::postcard::u8 channel_size,
+        ice::postcard::u8 bits,
+        ice::postcard::u8& out_last_read_channel
+    ) noexcept -> ice::postcard::usize
+    {
+        ice::postcard::u8 const isa = ice::postcard::u8(selected_isa());
+        if (isa == 0 || is_pixel_aligned(channel_count, out_last_read_channel) == false)
+        {
+            return 0;
+        }
+
+        Kernel const (&kernels)[3] = channel_size == 2
+            ? Constant_ReadKernels<2>[density_index(bits)][channel_count == 4]
+            : Constant_ReadKernels<1>[density_index(bits)][channel_count == 4];
+        if (target.size < kernels[0].payload_block)
+        {
+            return 0;
+        }
+
+        ice::postcard::u8* destination = reinterpret_cast<ice::postcard::u8*>(target.location);
+        ice::postcard::u8 const* source_bytes = reinterpret_cast<ice::postcard::u8 const*>(source.location);
+        ice::postcard::u8 const* const start = source_bytes;
+        ice::postcard::usize bytes_to_read = target.size;
+
+        if (out_last_read_channel == 3)
+        {
+            source_bytes += channel_size;
+            out_last_read_channel = 0;
+        }
+
+        for (ice::postcard::u8 idx = isa; idx > 0; idx -= 1)
+        {
+            Kernel const& kernel = kernels[idx - 1];
+            ice::postcard::usize const blocks = bytes_to_read / kernel.payload_block;
+            kernel.fn(destination, source_bytes, blocks);
+            destination += blocks * kernel.payload_block;
+            source_bytes += blocks * kernel.image_block;
+            bytes_to_read -= blocks * kernel.payload_block;
+        }
+
+        assert(ice::postcard::usize(source_bytes - start) <= source.size);
+        target = { destination, bytes_to_read };
+        return ice::postcard::usize(source_bytes - start);
+    }
+#else
+    auto detail::simd::selected_isa() noexcept -> ice::postcard::detail::simd::Isa
+    {
+        return Isa::None;
+    }
+
+    void detail::simd::limit_isa(ice::postcard::detail::simd::Isa) noexcept
+    {
+    }
+
+    auto detail::simd::write_postcard_data(
+        ice::postcard::Memory,
+        ice::postcard::Data&,
+        ice::postcard::u8,
+        ice::postcard::u8,
+        ice::postcard::u8,
+        ice::postcard::u8&
+    ) noexcept -> ice::postcard::usize
+    {
+        return 0;
+    }
+
+    auto detail::simd::read_postcard_data(
+        ice::postcard::Memory&,
+        ice::postcard::Data,
+        ice::postcard::u8,
+        ice::postcard::u8,
+        ice::postcard::u8,
+        ice::postcard::u8&
+    ) noexcept -> ice::postcard::usize
+    {
+        return 0;
+    }
+#endif // #if ICE_POSTCARD_SIMD_ENABLED
+
+} // namespace ice::postcard
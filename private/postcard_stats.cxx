@@ -0,0 +1,141 @@
+#include "postcard_detail.hxx"
+
+#if ICE_POSTCARD_STATS
+#include <chrono>
+#endif
+
+namespace ice::postcard
+{
+
+#if ICE_POSTCARD_STATS
+    namespace detail::stats
+    {
+
+        static ice::postcard::StatsHandlerFn* stats_handler = nullptr;
+        static void* stats_userdata = nullptr;
+        static thread_local ice::postcard::detail::stats::Counters* current_counters = nullptr;
+
+        static auto now_ns() noexcept -> ice::postcard::u64
+        {
+            return ice::postcard::u64(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+            );
+        }
+
+    } // namespace detail::stats
+
+    detail::stats::Scope::Scope(ice::postcard::StatsOperation operation) noexcept
+        : _operation{ operation }
+        , _start_ns{ 0 }
+        , _active{ current_counters == nullptr && stats_handler != nullptr }
+        , _counters{ }
+    {
+        if (_active)
+        {
+            current_counters = &_counters;
+            _start_ns = now_ns();
+        }
+    }
+
+    detail::stats::Scope::~Scope() noexcept
+    {
+        if (_active == false)
+        {
+            return;
+        }
+
+        ice::postcard::u64 const end_ns = now_ns();
+        current_counters = nullptr;
+
+        ice::postcard::PostcardStats const stats{
+            .operation = _operation,
+            .kernel = ice::postcard::StatsKernel(_counters.kernel.load(std::memory_order_relaxed)),
+            .image_bytes = _counters.image_bytes.load(std::memory_order_relaxed),
+            .payload_bytes = _counters.payload_bytes.load(std::memory_order_relaxed),
+            .scalar_bytes = _counters.scalar_bytes.load(std::memory_order_relaxed),
+            .allocations = _counters.allocations.load(std::memory_order_relaxed),
+            .allocation_ns = _counters.allocation_ns.load(std::memory_order_relaxed),
+            .elapsed_ns = end_ns - _start_ns,
+        };
+        stats_handler(stats, stats_userdata);
+    }
+
+    // The calling thread also runs tasks, its own counters are kept and not replaced.
+    detail::stats::Attach::Attach(ice::postcard::detail::stats::Counters* counters) noexcept
+        : _attached{ counters != nullptr && current_counters == nullptr }
+    {
+        if (_attached)
+        {
+            current_counters = counters;
+        }
+    }
+
+    detail::stats::Attach::~Attach() noexcept
+    {
+        if (_attached)
+        {
+            current_counters = nullptr;
+        }
+    }
+
+    auto detail::stats::current() noexcept -> ice::postcard::detail::stats::Counters*
+    {
+        return current_counters;
+    }
+
+    void detail::stats::record_data(
+        ice::postcard::usize payload_bytes,
+        ice::postcard::usize scalar_bytes,
+        ice::postcard::usize image_bytes,
+        ice::postcard::detail::simd::Isa kernel
+    ) noexcept
+    {
+        Counters* const counters = current_counters;
+        if (counters == nullptr)
+        {
+            return;
+        }
+
+        counters->payload_bytes.fetch_add(payload_bytes, std::memory_order_relaxed);
+        counters->scalar_bytes.fetch_add(scalar_bytes, std::memory_order_relaxed);
+        counters->image_bytes.fetch_add(image_bytes, std::memory_order_relaxed);
+
+        // All kernels of a call use the same instruction set, so a single store is enough.
+        if (payload_bytes > scalar_bytes)
+        {
+            counters->kernel.store(ice::postcard::u8(kernel), std::memory_order_relaxed);
+        }
+    }
+
+    auto detail::stats::allocate(ice::postcard::Allocator& allocator, ice::postcard::usize size) noexcept -> ice::postcard::Memory
+    {
+        Counters* const counters = current_counters;
+        if (counters == nullptr)
+        {
+            return allocator.allocate(size);
+        }
+
+        ice::postcard::u64 const start_ns = now_ns();
+        ice::postcard::Memory const result = allocator.allocate(size);
+        counters->allocation_ns.fetch_add(now_ns() - start_ns, std::memory_order_relaxed);
+        counters->allocations.fetch_add(1, std::memory_order_relaxed);
+        return result;
+    }
+
+    void set_stats_handler(ice::postcard::StatsHandlerFn* handler, void* userdata) noexcept
+    {
+        detail::stats::stats_handler = handler;
+        detail::stats::stats_userdata = userdata;
+    }
+#else
+    void set_stats_handler(ice::postcard::StatsHandlerFn*, void*) noexcept
+    {
+    }
+#endif // #if ICE_POSTCARD_STATS
+
+    bool stats_enabled() noexcept
+    {
+        return detail::stats::Constant_Enabled;
+    }
+
+} // namespace ice::postcard
@@ -1,5 +1,6 @@
 #pragma once
 #include <inttypes.h>
+#include <stddef.h>
 
 namespace ice::postcard
 {
@@ -8,7 +9,10 @@ namespace ice::postcard
     using u16 = uint16_t;
     using u32 = uint32_t;
     using u64 = uint64_t;
+    using i32 = int32_t;
+    using i64 = int64_t;
     using usize = size_t;
+    using isize = ptrdiff_t;
 
     struct Data
     {
@@ -24,35 +28,137 @@ namespace ice::postcard
 
     struct Allocator
     {
+        //! \brief Returns an empty block if the request cannot be served, the call then fails with 'ErrorMemory_AllocationFailed'.
         virtual auto allocate(ice::postcard::usize size) noexcept -> ice::postcard::Memory = 0;
         virtual void deallocate(ice::postcard::Memory memory) noexcept = 0;
 
         static auto get_default() noexcept -> ice::postcard::Allocator&;
     };
 
+    struct Executor
+    {
+        using TaskFn = void(void* userdata, ice::postcard::u32 task_index) noexcept;
+
+        //! \brief Number of tasks that can make progress at the same time.
+        virtual auto concurrency() const noexcept -> ice::postcard::u32 = 0;
+
+        //! \brief Calls 'task' once for each index in [0, task_count) and returns after all calls finished.
+        virtual void run(ice::postcard::u32 task_count, TaskFn* task, void* userdata) noexcept = 0;
+
+        //! \brief A small built-in thread pool, using all available hardware threads.
+        static auto get_default() noexcept -> ice::postcard::Executor&;
+    };
+
+    //! \brief Size of a single image channel in bytes.
+    enum class ChannelDepth : ice::postcard::u8
+    {
+        Bits8 = 1,
+
+        //! \brief Little-endian 16 bit channels, as used by 16 bit PNG or EXR half float images.
+        //! \details Data is stored in the least significant byte of each channel, the most significant byte is never changed.
+        Bits16 = 2,
+    };
+
     struct Image
     {
         ice::postcard::u32 width;
         ice::postcard::u32 height;
         ice::postcard::u8 channels;
         ice::postcard::Memory data;
+
+        //! \brief Number of bytes between the starts of two rows, zero if rows are tightly packed.
+        //! \details Allows using buffers with padded rows, like GPU staging buffers. Padding bytes are never changed.
+        ice::postcard::usize row_stride = 0;
+
+        ice::postcard::ChannelDepth depth = ice::postcard::ChannelDepth::Bits8;
+    };
+
+    enum class Compression : ice::postcard::u8
+    {
+        None,
+        LZ,
+    };
+
+    //! \brief Number of bits stored in each used channel, higher densities change the image more visibly.
+    enum class Density : ice::postcard::u8
+    {
+        Bits1 = 1,
+        Bits2 = 2,
+        Bits4 = 4,
     };
 
     struct PostcardInfo
     {
         ice::postcard::u16 revision = 0;
-        ice::postcard::u32 attachment_size = 0;
+
+        //! \brief Attachments of 4 GiB and more are stored with a larger header and can't be compressed.
+        ice::postcard::u64 attachment_size = 0;
+
+        //! \brief On write, the attachment is compressed if that makes it smaller. On read, the stored compression.
+        ice::postcard::Compression compression = ice::postcard::Compression::None;
+
+        //! \brief Number of attachment bytes embedded in the image if compressed, zero otherwise.
+        ice::postcard::u32 compressed_size = 0;
+
+        ice::postcard::Density density = ice::postcard::Density::Bits1;
+
+        //! \brief Set on read if the postcard stores a CRC32C checksum, which 'write' always adds.
+        bool has_checksum = false;
+
+        //! \brief Set on read if the attachment starts with a table of entries, see 'write_entries'.
+        bool has_entries = false;
+
+        //! \brief Set on read if the attachment is one shard of a larger one, see 'write_sharded'.
+        bool is_shard = false;
+    };
+
+    //! \brief Attachment stored next to others with 'write_entries', identified by a unique 'id'.
+    struct PostcardEntry
+    {
+        ice::postcard::u32 id;
+
+        //! \brief Not used by the library, stored in the table of entries as is.
+        ice::postcard::u32 flags = 0;
+
+        ice::postcard::Data data;
+    };
+
+    //! \brief Location of an entry, as stored in the table at the start of the attachment.
+    struct PostcardEntryInfo
+    {
+        ice::postcard::u32 id;
+        ice::postcard::u32 flags;
+
+        //! \brief Offset of the first entry byte from the start of the attachment.
+        ice::postcard::u32 offset;
+        ice::postcard::u32 size;
+    };
+
+    //! \brief Part of an attachment split across several images, as stored at the start of each shard.
+    struct PostcardShardInfo
+    {
+        //! \brief Identifies the attachment, all of its shards store the same value.
+        ice::postcard::u64 set_id;
+        ice::postcard::u64 total_size;
+
+        //! \brief Offset of the first shard byte in the whole attachment.
+        ice::postcard::u64 offset;
+        ice::postcard::u32 index;
+        ice::postcard::u32 count;
     };
 
     struct Attachment
     {
         Attachment() noexcept;
         Attachment(ice::postcard::Data data) noexcept;
+
+        //! \brief Copies 'data' into memory allocated from 'allocator'.
+        Attachment(ice::postcard::Data data, ice::postcard::Allocator& allocator) noexcept;
         Attachment(ice::postcard::Memory memory, ice::postcard::Allocator& allocator) noexcept;
         ~Attachment() noexcept;
 
-        Attachment(Attachment&& other) noexcept = default;
-        auto operator=(Attachment&& other) noexcept -> Attachment & = default;
+        Attachment(Attachment&& other) noexcept;
+        auto operator=(Attachment&& other) noexcept -> Attachment&;
         Attachment(Attachment const& other) noexcept = delete;
         auto operator=(Attachment const& other) noexcept -> Attachment & = delete;
 
@@ -65,9 +171,120 @@ namespace ice::postcard
         Success,
         ErrorRead_AttachmentNotFound,
         ErrorWrite_AttachmentTooBig,
+        ErrorWrite_AttachmentIncomplete,
+        ErrorRead_BufferTooSmall,
+        ErrorRead_RangeOutOfBounds,
+        ErrorRead_AttachmentCompressed,
+        ErrorRead_AttachmentCorrupted,
+        ErrorRead_DensityNotSupported,
+        ErrorRead_ChecksumMissing,
+        ErrorRead_ChecksumMismatch,
+        ErrorFile_OpenFailed,
+        ErrorFile_FormatNotSupported,
+        ErrorFile_WriteFailed,
+        ErrorImage_RegionOutOfBounds,
+        ErrorWrite_EntryDuplicated,
+        ErrorRead_EntriesMissing,
+        ErrorRead_EntryNotFound,
+        ErrorWrite_RangeOutOfBounds,
+        ErrorWrite_AttachmentCompressed,
+        ErrorAsync_Cancelled,
+        ErrorRead_ShardMissing,
+        ErrorRead_ShardSetIncomplete,
+        ErrorMemory_AllocationFailed,
+    };
+
+    //! \brief Postcard embedded by 'write_batch', 'result' is set once the batch finished.
+    struct PostcardWriteJob
+    {
+        ice::postcard::Image image;
+        ice::postcard::PostcardInfo info;
+        ice::postcard::Data attachment_data;
+        ice::postcard::Result result = ice::postcard::Result::Success;
+    };
+
+    //! \brief Postcard extracted by 'read_batch', all other members are set once the batch finished.
+    struct PostcardReadJob
+    {
+        ice::postcard::Image image;
+        ice::postcard::PostcardInfo info;
+
+        //! \brief Points into the memory returned by 'read_batch', empty if the job failed.
+        ice::postcard::Memory attachment_data;
+        ice::postcard::Result result = ice::postcard::Result::Success;
+    };
+
+    //! \brief Embeds a postcard into an image that is provided in consecutive parts, for example one row at a time.
+    //! \note Attachments are always stored uncompressed with one bit per channel and without a checksum,
+    //!   'info.compression' and 'info.density' are ignored. Image parts need to use 8 bit channels.
+    struct PostcardWriter
+    {
+        PostcardWriter(ice::postcard::PostcardInfo const& info, ice::postcard::u8 channels) noexcept;
+
+        //! \brief Embeds data into the next part of the image, taking bytes from the front of 'attachment_data'.
+        //! \details Bytes that did not fit are left in 'attachment_data' and need to be passed again with the next part.
+        //!   Fails without changes if 'attachment_data' is smaller than both, the part capacity and the remaining attachment.
+        auto write(
+            ice::postcard::Memory image_part,
+            ice::postcard::Data& attachment_data
+        ) noexcept -> ice::postcard::Result;
+
+        bool finished() const noexcept;
+
+        ice::postcard::u8 _channels;
+        ice::postcard::u8 _last_channel = 0;
+        ice::postcard::u8 _bit = 0;
+        ice::postcard::u8 _pending = 0;
+        ice::postcard::u8 _header_size;
+        ice::postcard::u64 _attachment_size;
+        ice::postcard::usize _taken = 0;
+        ice::postcard::u8 _header[16];
+    };
+
+    //! \brief Extracts a postcard from an image that is provided in consecutive parts, for example one row at a time.
+    //! \note Compressed attachments are not supported and fail with 'ErrorRead_AttachmentCompressed',
+    //!   attachments stored with a density other than 'Bits1' fail with 'ErrorRead_DensityNotSupported'.
+    //!   Image parts need to use 8 bit channels.
+    struct PostcardReader
+    {
+        PostcardReader(ice::postcard::u8 channels) noexcept;
+
+        //! \brief Extracts data from the next part of the image, storing attachment bytes at the front of 'attachment_data'.
+        //! \details Stored bytes are removed from the front of 'attachment_data'. Until 'read_info' succeeds the buffer needs
+        //!   room for 'image_part.size / 8 + 1' bytes, after that for the part capacity or the remaining attachment.
+        auto read(
+            ice::postcard::Data image_part,
+            ice::postcard::Memory& attachment_data
+        ) noexcept -> ice::postcard::Result;
+
+        //! \brief Available once enough of the image was read to contain the postcard header.
+        auto read_info(ice::postcard::PostcardInfo& out_info) const noexcept -> ice::postcard::Result;
+
+        bool finished() const noexcept;
+
+        ice::postcard::u8 _channels;
+        ice::postcard::u8 _last_channel = 0;
+        ice::postcard::u8 _bit = 0;
+        ice::postcard::u8 _pending = 0;
+        ice::postcard::usize _completed = 0;
+        ice::postcard::u8 _header[16];
     };
 
-    auto capacity(ice::postcard::Image const& image) noexcept -> ice::postcard::usize;
+    //! \brief Creates an image for a rectangle of 'image', sharing its pixels and row stride.
+    //! \details Used to embed postcards into a part of a larger image, like an atlas, without copying that part.
+    auto image_region(
+        ice::postcard::Image const& image,
+        ice::postcard::u32 x,
+        ice::postcard::u32 y,
+        ice::postcard::u32 width,
+        ice::postcard::u32 height,
+        ice::postcard::Image& out_region
+    ) noexcept -> ice::postcard::Result;
+
+    auto capacity(
+        ice::postcard::Image const& image,
+        ice::postcard::Density density = ice::postcard::Density::Bits1
+    ) noexcept -> ice::postcard::usize;
 
     auto write(
         ice::postcard::Image& image,
@@ -81,11 +298,38 @@ namespace ice::postcard
         ice::postcard::Data const& attachment_data
     ) noexcept -> ice::postcard::Result;
 
+    //! \brief Embeds 'part_count' parts one after another as a single attachment, without joining them first.
+    //! \details The attachment is always stored uncompressed, 'info.attachment_size' and 'info.compression' are ignored.
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Data const* parts,
+        ice::postcard::u32 part_count
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Writes the attachment by splitting it into stripes that are embedded in parallel.
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Attachment const& attachment,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result;
+
+    auto write(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Data const& attachment_data,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result;
+
     auto read_info(
         ice::postcard::Image const& image,
         ice::postcard::PostcardInfo& out_info
     ) noexcept -> ice::postcard::Result;
 
+    //! \brief Validates the postcard checksum, decoding the attachment in small chunks without allocating memory.
+    auto verify(ice::postcard::Image const& image) noexcept -> ice::postcard::Result;
+
     auto read(
         ice::postcard::Image const& image,
         ice::postcard::PostcardInfo& out_info,
@@ -100,4 +344,144 @@ namespace ice::postcard
         ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default()
     ) noexcept -> ice::postcard::Result;
 
+    //! \brief Reads the attachment into a caller provided buffer, without allocating any memory.
+    //! \details The buffer needs room for 'attachment_size + compressed_size' bytes, compressed data is extracted
+    //!   behind the attachment before it is decompressed. 'out_info' is also set when failing with 'ErrorRead_BufferTooSmall',
+    //!   so the same call can be used to find the required size.
+    auto read_into(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory attachment_buffer
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Reads 'length' attachment bytes starting at 'offset', decoding only the pixels holding them.
+    //! \note Compressed attachments are not supported and fail with 'ErrorRead_AttachmentCompressed'.
+    auto read_range(
+        ice::postcard::Image const& image,
+        ice::postcard::usize offset,
+        ice::postcard::usize length,
+        ice::postcard::Memory out_data
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Replaces 'patch.size' attachment bytes starting at 'offset', encoding only the pixels holding them.
+    //! \details The attachment size stays the same. A stored checksum is updated from the changed bytes alone,
+    //!   so the cost does not depend on the attachment size. A checksum that did not match before the update won't match after it.
+    //! \note Compressed attachments are not supported and fail with 'ErrorWrite_AttachmentCompressed'.
+    auto update(
+        ice::postcard::Image& image,
+        ice::postcard::usize offset,
+        ice::postcard::Data patch
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Embeds several attachments, preceded by a table of entries, so each one can be read on its own.
+    //! \details The table is sorted by ID and stored together with the entries as a single uncompressed attachment,
+    //!   'info.attachment_size' and 'info.compression' are ignored. Only the table is allocated from 'allocator'.
+    auto write_entries(
+        ice::postcard::Image& image,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::PostcardEntry const* entries,
+        ice::postcard::u32 entry_count,
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default()
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Reads up to 'entries_capacity' entries from the table, sorted by ID.
+    //! \details 'out_entry_count' is set to the number of stored entries, also when failing with 'ErrorRead_BufferTooSmall'.
+    //!   Postcards written without entries fail with 'ErrorRead_EntriesMissing'.
+    auto read_entries(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardEntryInfo* out_entries,
+        ice::postcard::u32 entries_capacity,
+        ice::postcard::u32& out_entry_count
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Reads the entry 'id', decoding only the pixels holding it and the table entries visited by a binary search.
+    auto read_entry(
+        ice::postcard::Image const& image,
+        ice::postcard::u32 id,
+        ice::postcard::PostcardEntryInfo& out_entry,
+        ice::postcard::Memory& out_entry_data,
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default()
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Reads the entry 'id' into a caller provided buffer, without allocating any memory.
+    //! \details 'out_entry' is also set when failing with 'ErrorRead_BufferTooSmall'.
+    auto read_entry_into(
+        ice::postcard::Image const& image,
+        ice::postcard::u32 id,
+        ice::postcard::PostcardEntryInfo& out_entry,
+        ice::postcard::Memory entry_buffer
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Reads the attachment by splitting it into stripes that are extracted in parallel.
+    auto read(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Attachment& out_attachment,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result;
+
+    auto read(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory& out_attachment_data,
+        ice::postcard::Allocator& allocator,
+        ice::postcard::Executor& executor
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Splits the attachment across 'image_count' images, embedding the shards in parallel.
+    //! \details Each image gets a share proportional to its capacity, so all shards take about the same time to process.
+    //!   Shards are stored uncompressed, 'info.attachment_size' and 'info.compression' are ignored. Only the shard
+    //!   layout is allocated from 'allocator'. Nothing is written if the attachment does not fit into all images together,
+    //!   or if any image is too small to hold a shard.
+    auto write_sharded(
+        ice::postcard::Image* images,
+        ice::postcard::u32 image_count,
+        ice::postcard::PostcardInfo const& info,
+        ice::postcard::Data attachment_data,
+        ice::postcard::u64 set_id,
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default(),
+        ice::postcard::Executor& executor = ice::postcard::Executor::get_default()
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Reads the shard stored in 'image', for example to group images by 'set_id' before calling 'read_sharded'.
+    //! \details Postcards written without 'write_sharded' fail with 'ErrorRead_ShardMissing'.
+    auto read_shard_info(
+        ice::postcard::Image const& image,
+        ice::postcard::PostcardShardInfo& out_shard
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Reassembles an attachment written with 'write_sharded', extracting the shards in parallel.
+    //! \details Images can be passed in any order, but need to hold every shard of a single attachment exactly once,
+    //!   otherwise 'ErrorRead_ShardSetIncomplete' is returned. 'out_info' describes the whole attachment.
+    auto read_sharded(
+        ice::postcard::Image const* images,
+        ice::postcard::u32 image_count,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory& out_attachment_data,
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default(),
+        ice::postcard::Executor& executor = ice::postcard::Executor::get_default()
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Embeds all jobs, spreading them over the executor threads in groups so many small images are processed efficiently.
+    //! \details Each job is handled like a call to 'write'. The result of every job is stored in the job itself.
+    //! \returns 'Success' if all jobs succeeded, otherwise the result of the first failed job.
+    auto write_batch(
+        ice::postcard::PostcardWriteJob* jobs,
+        ice::postcard::u32 job_count,
+        ice::postcard::Executor& executor = ice::postcard::Executor::get_default()
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Extracts all jobs, spreading them over the executor threads in groups so many small images are processed efficiently.
+    //! \details All attachments are extracted into a single allocation from 'allocator', returned in 'out_batch_data'
+    //!   and released at once by the caller. Each job is handled like a call to 'read', its result is stored in the job itself.
+    //! \returns 'Success' if all jobs succeeded, otherwise the result of the first failed job.
+    auto read_batch(
+        ice::postcard::PostcardReadJob* jobs,
+        ice::postcard::u32 job_count,
+        ice::postcard::Memory& out_batch_data,
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default(),
+        ice::postcard::Executor& executor = ice::postcard::Executor::get_default()
+    ) noexcept -> ice::postcard::Result;
+
 } // namespace ice::postcard
@@ -0,0 +1,63 @@
+#pragma once
+#include <ice/postcard.hxx>
+
+namespace ice::postcard
+{
+
+    //! \brief Keeps freed blocks in power-of-two size classes, so repeated reads of similar sizes stop reaching 'backing'.
+    //! \details Each thread caches a few blocks per size class of the pool it used last, the rest is shared between threads.
+    //!   Blocks larger than the biggest size class are passed directly to 'backing', which needs to outlive all threads
+    //!   that used the pool. Blocks cached by other threads are released once those threads exit or switch pools.
+    struct PoolAllocator : public ice::postcard::Allocator
+    {
+        struct State;
+
+        PoolAllocator(ice::postcard::Allocator& backing = ice::postcard::Allocator::get_default()) noexcept;
+        ~PoolAllocator() noexcept;
+
+        PoolAllocator(PoolAllocator const& other) noexcept = delete;
+        auto operator=(PoolAllocator const& other) noexcept -> PoolAllocator & = delete;
+
+        auto allocate(ice::postcard::usize size) noexcept -> ice::postcard::Memory override;
+        void deallocate(ice::postcard::Memory memory) noexcept override;
+
+        ice::postcard::Allocator* _backing;
+        State* _state;
+    };
+
+    //! \brief Hands out memory by bumping a pointer, everything is released at once with 'reset'.
+    //! \details Only the most recent allocation is given back by 'deallocate', all others stay in use until 'reset'.
+    //!   The arena is not thread safe, but all postcard functions allocate on the calling thread only.
+    struct ArenaAllocator : public ice::postcard::Allocator
+    {
+        struct Chunk;
+
+        //! \brief Allocates from 'buffer' only, requests that do not fit return empty memory.
+        ArenaAllocator(ice::postcard::Memory buffer) noexcept;
+
+        //! \brief Allocates chunks of at least 'chunk_size' bytes from 'backing' when needed, they are kept until destroyed.
+        ArenaAllocator(
+            ice::postcard::Allocator& backing,
+            ice::postcard::usize chunk_size = 1024 * 1024
+        ) noexcept;
+        ~ArenaAllocator() noexcept;
+
+        ArenaAllocator(ArenaAllocator const& other) noexcept = delete;
+        auto operator=(ArenaAllocator const& other) noexcept -> ArenaAllocator & = delete;
+
+        auto allocate(ice::postcard::usize size) noexcept -> ice::postcard::Memory override;
+        void deallocate(ice::postcard::Memory memory) noexcept override;
+
+        //! \brief Makes all memory available again, previous allocations must no longer be used.
+        void reset() noexcept;
+
+        ice::postcard::Allocator* _backing;
+        ice::postcard::usize _chunk_size;
+        ice::postcard::Memory _buffer;
+        Chunk* _chunks = nullptr;
+        Chunk* _current = nullptr;
+        ice::postcard::u8* _position = nullptr;
+        ice::postcard::u8* _end = nullptr;
+    };
+
+} // namespace ice::postcard
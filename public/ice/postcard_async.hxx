@@ -0,0 +1,129 @@
+#pragma once
+#include <ice/postcard.hxx>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+
+namespace ice::postcard
+{
+
+    //! \brief Resumes suspended asynchronous operations, for example from a job system or once per frame.
+    struct Scheduler
+    {
+        //! \brief Queues 'coroutine' to be resumed later, on any thread.
+        //! \details Should not resume it before returning, otherwise each processed chunk adds a nested call to the stack.
+        virtual void schedule(std::coroutine_handle<> coroutine) noexcept = 0;
+    };
+
+    //! \brief Stops asynchronous operations using it before their next chunk, can be cancelled from any thread.
+    struct CancellationToken
+    {
+        void cancel() noexcept;
+        bool cancelled() const noexcept;
+
+        std::atomic<bool> _cancelled = false;
+    };
+
+    //! \brief Lazily started operation, runs once awaited or started and produces a 'Result'.
+    //! \details Continues on the thread that resumed its last chunk. Destroying it before it finished is only allowed
+    //!   while it is not queued on a scheduler.
+    struct [[nodiscard]] AsyncResult
+    {
+        struct promise_type
+        {
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                void await_resume() const noexcept { }
+
+                auto await_suspend(std::coroutine_handle<promise_type> coroutine) const noexcept -> std::coroutine_handle<>
+                {
+                    return coroutine.promise().continuation;
+                }
+            };
+
+            auto get_return_object() noexcept -> ice::postcard::AsyncResult
+            {
+                return ice::postcard::AsyncResult{ std::coroutine_handle<promise_type>::from_promise(*this) };
+            }
+
+            auto initial_suspend() const noexcept -> std::suspend_always { return { }; }
+            auto final_suspend() const noexcept -> FinalAwaiter { return { }; }
+            void return_value(ice::postcard::Result value) noexcept { result = value; }
+            void unhandled_exception() const noexcept { std::terminate(); }
+
+            ice::postcard::Result result = ice::postcard::Result::Success;
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+        };
+
+        explicit AsyncResult(std::coroutine_handle<promise_type> coroutine) noexcept
+            : _coroutine{ coroutine }
+        {
+        }
+
+        ~AsyncResult() noexcept
+        {
+            if (_coroutine)
+            {
+                _coroutine.destroy();
+            }
+        }
+
+        AsyncResult(AsyncResult&& other) noexcept
+            : _coroutine{ other._coroutine }
+        {
+            other._coroutine = nullptr;
+        }
+
+        auto operator=(AsyncResult&& other) noexcept -> AsyncResult & = delete;
+        AsyncResult(AsyncResult const& other) noexcept = delete;
+        auto operator=(AsyncResult const& other) noexcept -> AsyncResult & = delete;
+
+        //! \brief Runs the operation up to its first suspension, for callers that poll 'done' instead of awaiting it.
+        void start() noexcept { _coroutine.resume(); }
+
+        bool done() const noexcept { return _coroutine.done(); }
+
+        //! \brief The result of a finished operation.
+        auto result() const noexcept -> ice::postcard::Result { return _coroutine.promise().result; }
+
+        bool await_ready() const noexcept { return false; }
+        auto await_resume() const noexcept -> ice::postcard::Result { return result(); }
+
+        auto await_suspend(std::coroutine_handle<> awaiting) noexcept -> std::coroutine_handle<>
+        {
+            _coroutine.promise().continuation = awaiting;
+            return _coroutine;
+        }
+
+        std::coroutine_handle<promise_type> _coroutine;
+    };
+
+    //! \brief Same as 'write', but embeds the attachment in chunks of 'chunk_size' bytes, yielding to 'scheduler' between them.
+    //! \details Compression is done in a single step before the first chunk. Pixels, the attachment, 'scheduler' and
+    //!   'cancellation' need to stay valid until the operation finished. If cancelled, the postcard header is erased,
+    //!   so the image no longer holds a postcard, and 'ErrorAsync_Cancelled' is returned.
+    auto async_write(
+        ice::postcard::Image image,
+        ice::postcard::PostcardInfo info,
+        ice::postcard::Data attachment_data,
+        ice::postcard::Scheduler& scheduler,
+        ice::postcard::CancellationToken const* cancellation = nullptr,
+        ice::postcard::usize chunk_size = 64 * 1024
+    ) noexcept -> ice::postcard::AsyncResult;
+
+    //! \brief Same as 'read', but extracts the attachment in chunks of 'chunk_size' bytes, yielding to 'scheduler' between them.
+    //! \details Decompression is done in a single step after the last chunk. Pixels, the outputs, 'scheduler', 'cancellation'
+    //!   and 'allocator' need to stay valid until the operation finished. If cancelled, the memory is released
+    //!   and 'ErrorAsync_Cancelled' is returned.
+    auto async_read(
+        ice::postcard::Image image,
+        ice::postcard::PostcardInfo& out_info,
+        ice::postcard::Memory& out_attachment_data,
+        ice::postcard::Scheduler& scheduler,
+        ice::postcard::CancellationToken const* cancellation = nullptr,
+        ice::postcard::Allocator& allocator = ice::postcard::Allocator::get_default(),
+        ice::postcard::usize chunk_size = 64 * 1024
+    ) noexcept -> ice::postcard::AsyncResult;
+
+} // namespace ice::postcard
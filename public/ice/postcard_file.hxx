@@ -0,0 +1,61 @@
+#pragma once
+#include <ice/postcard.hxx>
+
+namespace ice::postcard
+{
+
+    enum class FileFormat : ice::postcard::u8
+    {
+        Unknown,
+        BMP,
+        PPM,
+        TGA,
+    };
+
+    enum class FileAccess : ice::postcard::u8
+    {
+        //! \brief Changes done through 'ImageFile::image' stay in memory and are discarded when the file is closed.
+        Read,
+
+        //! \brief Changes done through 'ImageFile::image' are written back to the file.
+        ReadWrite,
+    };
+
+    //! \brief An uncompressed image file mapped into memory, only pages that are accessed are loaded from disk.
+    //! \details The 'image' member points directly into the mapping, with pixels in the same order as in the file.
+    //!   'bottom_up' and 'bgr' describe that order, so postcards are always embedded starting with the first stored row.
+    struct ImageFile
+    {
+        ImageFile() noexcept = default;
+        ~ImageFile() noexcept;
+
+        ImageFile(ImageFile&& other) noexcept;
+        auto operator=(ImageFile&& other) noexcept -> ImageFile&;
+        ImageFile(ImageFile const& other) noexcept = delete;
+        auto operator=(ImageFile const& other) noexcept -> ImageFile & = delete;
+
+        ice::postcard::FileFormat format = ice::postcard::FileFormat::Unknown;
+
+        //! \brief Rows are stored starting with the bottom row of the picture.
+        bool bottom_up = false;
+
+        //! \brief Color channels are stored as blue, green, red.
+        bool bgr = false;
+
+        ice::postcard::Image image{ };
+
+        ice::postcard::Memory _mapping{ };
+    };
+
+    //! \brief Maps a BMP (24 or 32 bit, uncompressed), binary PPM (8 bit) or uncompressed TGA (24 or 32 bit) file.
+    //! \details Only the file header is parsed, pixel data is not touched until used.
+    auto open_image_file(
+        char const* path,
+        ice::postcard::FileAccess access,
+        ice::postcard::ImageFile& out_file
+    ) noexcept -> ice::postcard::Result;
+
+    //! \brief Writes modified pages of a file opened with 'FileAccess::ReadWrite' back to disk.
+    auto flush_image_file(ice::postcard::ImageFile& file) noexcept -> ice::postcard::Result;
+
+} // namespace ice::postcard
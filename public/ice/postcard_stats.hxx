@@ -0,0 +1,66 @@
+#pragma once
+#include <ice/postcard.hxx>
+
+namespace ice::postcard
+{
+
+    enum class StatsOperation : ice::postcard::u8
+    {
+        Write,
+        WriteEntries,
+        Read,
+        ReadInto,
+        ReadRange,
+        ReadEntries,
+        ReadEntry,
+        Verify,
+        Update,
+        WriteSharded,
+        ReadSharded,
+        WriteBatch,
+        ReadBatch,
+    };
+
+    //! \brief Kernels used to embed or extract data, ordered from the narrowest to the widest.
+    enum class StatsKernel : ice::postcard::u8
+    {
+        Scalar,
+        SSE41,
+        AVX2,
+        AVX512,
+    };
+
+    //! \brief Costs of a single call, including the work done by executor threads for the parallel versions.
+    struct PostcardStats
+    {
+        ice::postcard::StatsOperation operation;
+
+        //! \brief Widest kernel that processed any data, 'Scalar' if everything was handled by the scalar path.
+        ice::postcard::StatsKernel kernel;
+
+        //! \brief Image bytes holding the embedded or extracted data, including skipped alpha channels.
+        ice::postcard::usize image_bytes;
+
+        //! \brief Bytes embedded or extracted, including the postcard headers and checksum.
+        ice::postcard::usize payload_bytes;
+
+        //! \brief Part of 'payload_bytes' handled by the scalar path, because it did not fill a whole SIMD block.
+        ice::postcard::usize scalar_bytes;
+
+        ice::postcard::u32 allocations;
+        ice::postcard::u64 allocation_ns;
+        ice::postcard::u64 elapsed_ns;
+    };
+
+    using StatsHandlerFn = void(ice::postcard::PostcardStats const& stats, void* userdata) noexcept;
+
+    //! \brief Sets the function called at the end of each 'write', 'read' and 'verify' call, 'nullptr' disables reporting.
+    //! \details The handler is called on the thread that made the call. Nested calls, like 'read' taking an 'Attachment',
+    //!   are reported once. Does nothing unless the library was built with 'ICE_POSTCARD_STATS', see 'stats_enabled'.
+    //! \note Not thread safe, needs to be called while no postcard is read or written.
+    void set_stats_handler(ice::postcard::StatsHandlerFn* handler, void* userdata = nullptr) noexcept;
+
+    //! \brief Returns 'true' if the library collects statistics, otherwise all instrumentation is compiled out.
+    bool stats_enabled() noexcept;
+
+} // namespace ice::postcard